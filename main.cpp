@@ -4,12 +4,14 @@
 #include <pthread.h>
 #include <thread>
 #include <bitset>
+#include <algorithm>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <shader_s.h>
 #include <defines.h>
 #include <scene_object_data_manager.h>
 #include <scene_object_manager.h>
+#include <frame_profiler.h>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void keyboard_callback(GLFWwindow* window, int key, int scancode, int action, int mode);
@@ -19,6 +21,11 @@ void update_fps(GLFWwindow* window);
 const uint32_t SCR_WIDTH = 1280;
 const uint32_t SCR_HEIGHT = 750;
 
+// Logical resolution of the game: 32x20 cells of 16x16 pixels. The scene is rendered at this resolution and upscaled to the window.
+const uint32_t GAME_WIDTH = 32*16;
+const uint32_t GAME_HEIGHT = 20*16;
+const uint32_t GAME_BOTTOM_OFFSET = 6*16; // The lowest rows of the scene are below the bottom of the screen
+
 pthread_t gameLogicMainThreadId;
 
 const uint32_t OBJECT_COUNT = 1000;
@@ -33,22 +40,37 @@ uint8_t pressedKeys = KEY_NONE;
 bool running = true;
 
 GLFWwindow* window;
-uint32_t VBO, VAO, UBO, textureId;
+uint32_t VBO, VAO, UBO, PBO, textureId, paletteTextureId;
+uint32_t FBO, renderTextureId;
+int32_t upscaledX, upscaledY, upscaledWidth, upscaledHeight;
 Shader* ourShader;
 SceneObjectDataManager *objectTextureManager;
 SceneObjectManager *sceneObjectManager;
+FrameProfiler *frameProfiler;
 
 void render()
 {
+        // Render the scene at the logical resolution of the game
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glViewport(0, 0, GAME_WIDTH, GAME_HEIGHT);
         glClear(GL_COLOR_BUFFER_BIT);
         glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
         glEnable(GL_BLEND);
         glEnable(GL_CULL_FACE);
         glDisable(GL_DEPTH_TEST);
         glDisable(GL_SCISSOR_TEST);
+        frameProfiler->BeginGpuStage(GPU_DRAW);
         glBindVertexArray(VAO);
         glDrawArrays(GL_TRIANGLES, 0, OBJECT_COUNT * 6);
+
+        // Upscale the rendered scene to the window in a single blit
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glBlitFramebuffer(0, 0, GAME_WIDTH, GAME_HEIGHT, upscaledX, upscaledY, upscaledX + upscaledWidth, upscaledY + upscaledHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        frameProfiler->EndGpuStage();
         glfwSwapBuffers(window);
+        frameProfiler->EndGpuFrame();
 }
 
 static void* gameLogicMainThreadFunc(void* v)
@@ -66,9 +88,16 @@ static void* gameLogicMainThreadFunc(void* v)
 int main()
 {
         objectTextureManager = new SceneObjectDataManager();
+        frameProfiler = new FrameProfiler();
         UInt16DoubleBuffer *verticesDoubleBuffer = new UInt16DoubleBuffer(OBJECT_COUNT * 12);
-        FloatDoubleBuffer *uvsDoubleBuffer = new FloatDoubleBuffer(OBJECT_COUNT * 12);
-        sceneObjectManager = new SceneObjectManager(objectTextureManager, verticesDoubleBuffer, uvsDoubleBuffer, OBJECT_COUNT);
+        FloatDoubleBuffer *uvsDoubleBuffer = new FloatDoubleBuffer(OBJECT_COUNT * 18);
+        UInt16DoubleBuffer *palettesDoubleBuffer = new UInt16DoubleBuffer(OBJECT_COUNT * 6);
+        sceneObjectManager = new SceneObjectManager(objectTextureManager, verticesDoubleBuffer, uvsDoubleBuffer, palettesDoubleBuffer, frameProfiler, OBJECT_COUNT);
+        if(!sceneObjectManager->IsLevelLoaded())
+        {
+                std::cout << "Failed to load level " << LEVEL_FILENAME << std::endl;
+                return -1;
+        }
 
         glfwInit();
         glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -98,9 +127,31 @@ int main()
         }
 
         ourShader = new Shader("shader.vs", "shader.fs");
+        frameProfiler->CreateGpuQueries();
+
+        // Offscreen render target at the logical resolution of the game
+        glGenTextures(1, &renderTextureId);
+        glBindTexture(GL_TEXTURE_2D, renderTextureId);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, GAME_WIDTH, GAME_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, renderTextureId, 0);
+        if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+                std::cout << "Failed to create the offscreen framebuffer" << std::endl;
+                return -1;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-        // Load texture atlas into GPU memory
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        framebuffer_size_callback(window, framebufferWidth, framebufferHeight);
+
+        // Load indexed texture atlas pages and their palettes into GPU memory
         textureId = objectTextureManager->LoadObjectsTextures();
+        paletteTextureId = objectTextureManager->GetPaletteTextureId();
 
         // Initial scene update
         sceneObjectManager->Update(pressedKeys);
@@ -108,6 +159,7 @@ int main()
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);
         glGenBuffers(1, &UBO);
+        glGenBuffers(1, &PBO);
         glBindVertexArray(VAO);
 
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
@@ -116,17 +168,30 @@ int main()
 
         glBindBuffer(GL_ARRAY_BUFFER, UBO);
         glBufferData(GL_ARRAY_BUFFER, uvsDoubleBuffer->size(), uvsDoubleBuffer->consumer_buffer, GL_DYNAMIC_DRAW /*GL_STATIC_DRAW*/);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_TRUE, 2 * sizeof(float), 0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), 0);
+
+        // Palette id of every vertex
+        glBindBuffer(GL_ARRAY_BUFFER, PBO);
+        glBufferData(GL_ARRAY_BUFFER, palettesDoubleBuffer->size(), palettesDoubleBuffer->consumer_buffer, GL_DYNAMIC_DRAW);
+        glVertexAttribIPointer(2, 1, GL_UNSIGNED_SHORT, sizeof(uint16_t), 0);
 
         glEnableVertexAttribArray(0);
         glEnableVertexAttribArray(1);
+        glEnableVertexAttribArray(2);
 
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         glBindVertexArray(0);
 
         ourShader->use();
+        ourShader->setInt("tex", 0);
+        ourShader->setInt("palettes", 1);
+        glUniform2f(glGetUniformLocation(ourShader->ID, "resolution"), GAME_WIDTH, GAME_HEIGHT);
+        ourShader->setFloat("bottomOffset", GAME_BOTTOM_OFFSET);
+        glUniform2fv(glGetUniformLocation(ourShader->ID, "pageScales"), objectTextureManager->GetAtlasPagesCount(), objectTextureManager->GetAtlasPageScales());
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textureId);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, textureId);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, paletteTextureId);
         glBindVertexArray(VAO);
 
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -136,10 +201,10 @@ int main()
         while (!glfwWindowShouldClose(window))
         {
                 auto t0 = std::chrono::high_resolution_clock::now();
-                glViewport(0, -215, 16*100*2, 9*100*2);
 
                 process_input(window);
                 glfwPollEvents();
+                frameProfiler->BeginGpuStage(GPU_UPLOAD);
                 glBindBuffer(GL_ARRAY_BUFFER, VBO);
                 verticesDoubleBuffer->lock();
                 glBufferSubData(GL_ARRAY_BUFFER, 0, verticesDoubleBuffer->size(), verticesDoubleBuffer->consumer_buffer);
@@ -150,6 +215,12 @@ int main()
                 glBufferSubData(GL_ARRAY_BUFFER, 0, uvsDoubleBuffer->size(), uvsDoubleBuffer->consumer_buffer);
                 uvsDoubleBuffer->unlock();
 
+                glBindBuffer(GL_ARRAY_BUFFER, PBO);
+                palettesDoubleBuffer->lock();
+                glBufferSubData(GL_ARRAY_BUFFER, 0, palettesDoubleBuffer->size(), palettesDoubleBuffer->consumer_buffer);
+                palettesDoubleBuffer->unlock();
+                frameProfiler->EndGpuStage();
+
                 render();
                 update_fps(window);
 
@@ -163,7 +234,12 @@ int main()
         glDeleteVertexArrays(1, &VAO);
         glDeleteBuffers(1, &VBO);
         glDeleteBuffers(1, &UBO);
+        glDeleteBuffers(1, &PBO);
         glDeleteTextures(1, &textureId);
+        glDeleteTextures(1, &paletteTextureId);
+        glDeleteFramebuffers(1, &FBO);
+        glDeleteTextures(1, &renderTextureId);
+        frameProfiler->DeleteGpuQueries();
 
         glfwTerminate();
 
@@ -172,6 +248,8 @@ int main()
         delete sceneObjectManager;
         delete verticesDoubleBuffer;
         delete uvsDoubleBuffer;
+        delete palettesDoubleBuffer;
+        delete frameProfiler;
 
         return 0;
 }
@@ -184,7 +262,12 @@ void process_input(GLFWwindow *window)
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
-        //glViewport(0, 0, width, height);
+        // Biggest integer scale of the logical resolution that fits in the window, centered
+        int32_t scale = std::max(1, std::min(width / int32_t(GAME_WIDTH), height / int32_t(GAME_HEIGHT)));
+        upscaledWidth = GAME_WIDTH * scale;
+        upscaledHeight = GAME_HEIGHT * scale;
+        upscaledX = (width - upscaledWidth) / 2;
+        upscaledY = (height - upscaledHeight) / 2;
 }
 
 void keyboard_callback(GLFWwindow* window, int key, int32_t scancode, int32_t action, int32_t mode)
@@ -221,12 +304,14 @@ void update_fps(GLFWwindow* win)
         }
 
         if ( currentTime - lastTime >= 1.0 ) { // If last count was more than 1 sec ago
-                char title [256];
-                title[255] = '\0';
+                char title [512];
+                char stages [256];
+                title[511] = '\0';
 
                 std::chrono::milliseconds ms = std::chrono::duration_cast<std::chrono::milliseconds>(cpuTimePerUpdate);
                 std::chrono::microseconds micro = std::chrono::duration_cast<std::chrono::microseconds>(cpuTimePerUpdate);
-                snprintf(title, 255, "%s - [FPS: %d] [GPU frame time: %f ms] [CPU update time: %lld ms | %lld micro]", "Rocket", nbFrames, 1000.0f/nbFrames, ms.count(), micro.count());
+                frameProfiler->Summary(stages, sizeof(stages));
+                snprintf(title, 511, "%s - [FPS: %d] [Frame time: %f ms] [CPU update time: %lld ms | %lld micro] %s", "Rocket", nbFrames, 1000.0f/nbFrames, ms.count(), micro.count(), stages);
                 glfwSetWindowTitle(win, title);
                 previousFPS = nbFrames;
                 nbFrames = 0;
@@ -1,8 +1,12 @@
 #version 330
 out vec4 color;
-in vec2 uv;
-uniform sampler2D tex;
+in vec3 uv;
+flat in uint palette;
+uniform sampler2DArray tex;
+uniform sampler2D palettes;
 void main()
 {
-    color = texture(tex, uv);
+    // The atlas pages store palette indexes, index 0 is transparent
+    int index = int(texture(tex, uv).r * 255.0 + 0.5);
+    color = texelFetch(palettes, ivec2(index, int(palette)), 0);
 }
@@ -1,9 +1,17 @@
 #version 330
 layout (location = 0) in vec2 vert;
-layout (location = 1) in vec2 _uv;
-out vec2 uv;
+layout (location = 1) in vec3 _uv;
+layout (location = 2) in uint _palette;
+out vec3 uv;
+flat out uint palette;
+uniform vec2 pageScales[16];
+uniform vec2 resolution;
+uniform float bottomOffset;
 void main()
 {
-    uv = _uv;
-    gl_Position = vec4(vert.x / 720.0 - 1.0, vert.y / 405.0 - 1.0, 0.0, 1.0);
+    // The third texture coordinate is the atlas page (layer of the texture array)
+    uv = vec3(_uv.xy * pageScales[int(_uv.z)], _uv.z);
+    palette = _palette;
+    // Scene coordinates are pixels of the logical resolution of the game
+    gl_Position = vec4(vert.x * 2.0 / resolution.x - 1.0, (vert.y - bottomOffset) * 2.0 / resolution.y - 1.0, 0.0, 1.0);
 }
@@ -1,6 +1,13 @@
 #include <collision/algorithm/CollisionDetector.h>
 #include <collision/math/Vector2Util.h>
 #include <iostream>
+#include <limits>
+#include <algorithm>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
 
 namespace collision {
 
@@ -8,31 +15,22 @@ namespace collision {
 
     }
 
-    bool CollisionDetector::checkCollision(Rectangle &rectangle_a, Rectangle &rectangle_b, Penetration &penetration,
+    bool CollisionDetector::checkCollision(const Box2 &box_a, const Box2 &box_b, Penetration &penetration,
                                            vec2<int16_t> &vectorDirection) {
 
-        if ((rectangle_a.vertices.size() < 4) || (rectangle_b.vertices.size() < 4)) {
-            return false;
-        }
-
-        //std::cout << "CHECKING COLLISION BETWEEN ";
-        //rectangle_a.Print();
-        //std::cout << " AND ";
-        //rectangle_b.Print();
-        //std::cout << "\n";
-
         penetration.depth.x = 0;
         penetration.depth.y = 0;
 
-        uint16_t a_x1 = rectangle_a.x1;
-        uint16_t a_y1 = rectangle_a.y1;
-        uint16_t a_x2 = rectangle_a.x2;
-        uint16_t a_y2 = rectangle_a.y2;
+        // Signed, so boxes partly scrolled below the screen (negative coordinates) don't wrap around
+        int32_t a_x1 = int32_t(box_a.x1);
+        int32_t a_y1 = int32_t(box_a.y1);
+        int32_t a_x2 = int32_t(box_a.x2);
+        int32_t a_y2 = int32_t(box_a.y2);
 
-        uint16_t b_x1 = rectangle_b.x1;
-        uint16_t b_y1 = rectangle_b.y1;
-        uint16_t b_x2 = rectangle_b.x2;
-        uint16_t b_y2 = rectangle_b.y2;
+        int32_t b_x1 = int32_t(box_b.x1);
+        int32_t b_y1 = int32_t(box_b.y1);
+        int32_t b_x2 = int32_t(box_b.x2);
+        int32_t b_y2 = int32_t(box_b.y2);
 /*
   std::cout << "aX1: " << a_x1 << " bX2: " << b_x2 << " aX2: " << a_x2 << " bX1: " << b_x1 << " aY1: " << a_y1 << " bY2: " << b_y2 << " aY2: " << a_y2 << " bY1: " << b_y1 << "\n";
   std::cout << "aX1 < bX2: " << (a_x1 < b_x2) << "\n";
@@ -58,8 +56,6 @@ namespace collision {
                 penetration.depth.y = -(b_y1 - a_y2);
             }
 
-            std::cout << " DIRECTION X: " << vectorDirection.x << " Y: " << vectorDirection.y << "\n";
-            std::cout << " DEPTH X: " << penetration.depth.x << " Y: " << penetration.depth.y << "\n";
 //    std::cout << " >>>>> COLLISIO <<<<<\n";
             return true;
         }
@@ -68,81 +64,177 @@ namespace collision {
         return false;
     }
 
-    void CollisionDetector::updateWithNonCollidingPosition(std::vector<collision::Rectangle> &targetRectangles,
-                                                           std::vector<collision::Rectangle> &movingRectangles,
-                                                           Position &position,
-                                                           vec2<int16_t> &vectorDirection) {
-        uint16_t targetRectanglesCount = targetRectangles.size();
-        uint16_t movingRectanglesCount = movingRectangles.size();
-        float tangent = position.getTrajectoryTangent();
-        float initial_x = position.GetPrevX();
-        float initial_y = position.GetPrevY();
-        float y_intercept = initial_y - (tangent * initial_x);
-        float start_x = initial_x + (vectorDirection.x >= 0 ? -5.0f : 5.0f); //initial_x;
-        float start_y = (tangent * start_x) + y_intercept; //initial_y;
-        float final_x = position.GetRealX();
-        float final_y = position.GetRealY();
-        float end_x = final_x;
-        float end_y = final_y;
-        float current_x, current_y, offset_x, offset_y;
-        float prev_start_x = start_x, prev_start_y = start_y;
-        bool current_position_collides;
-        collision::Penetration penetration;
-
-        bool position_of_no_collision_found = false;
-        while(!position_of_no_collision_found) {
-            current_position_collides = false;
-            current_x = start_x + ((end_x - start_x) / 2.0f);
-            current_y = (tangent * current_x) + y_intercept;
-            std::cout << "START => X: " << start_x << " Y: " << start_y << "\n";
-            std::cout << "END => X: " << end_x << " Y: " << end_y << "\n";
-            std::cout << "HALF => X: " << current_x << " Y: " << current_y << "\n";
-
-            offset_x = current_x - final_x;
-            offset_y = current_y - final_y;
-
-            std::cout << "OFFSET => X: " << offset_x << " Y: " << offset_y << "\n";
-
-            for (uint16_t i = 0; (i < movingRectanglesCount) && !current_position_collides; i++) {
-                Rectangle &movingRectangle = movingRectangles[i];
-                std::cout << "RECTANGLE NO   OFFSET: ";
-                movingRectangle.Print();
-                Rectangle *tempRectangle = movingRectangle.cloneWithOffset(offset_x, offset_y);
-                std::cout << "\nRECTANGLE WITH OFFSET: ";
-                tempRectangle->Print();
-
-                for (uint16_t e = 0; (e < targetRectanglesCount) && !current_position_collides; e++) {
-                    Rectangle &targetRectangle = targetRectangles[e];
-                    if(checkCollision(*tempRectangle, targetRectangle, penetration, vectorDirection)) {
-                        current_position_collides = true;
-                    }
-                }
-
-                tempRectangle->Print();
-                delete tempRectangle;
+    // The batch works on the coordinates truncated to signed integers like checkCollision. Inside a collision
+    // b_x1 < a_x2 and a_x1 < b_x2 always hold, so the penetration only depends on the direction, which is the same
+    // for the whole batch: it picks one subtraction per axis (or none).
+    uint32_t CollisionDetector::checkCollisionBatch(const Box2 &box_a, const BoxBatch &batch,
+                                                    const vec2<int16_t> &vectorDirection, uint32_t *hitIndexes,
+                                                    Penetration *penetrations) {
+        int32_t a_x1 = int32_t(box_a.x1);
+        int32_t a_y1 = int32_t(box_a.y1);
+        int32_t a_x2 = int32_t(box_a.x2);
+        int32_t a_y2 = int32_t(box_a.y2);
+        uint32_t hits = 0;
+        size_t i = 0;
+
+#if defined(__AVX2__)
+        const __m256i ax1 = _mm256_set1_epi32(a_x1), ay1 = _mm256_set1_epi32(a_y1);
+        const __m256i ax2 = _mm256_set1_epi32(a_x2), ay2 = _mm256_set1_epi32(a_y2);
+        alignas(32) int32_t depthX[8], depthY[8];
+        for (; i < batch.paddedCount(); i += 8) {
+            __m256i bx1 = _mm256_cvttps_epi32(_mm256_loadu_ps(&batch.x1[i]));
+            __m256i by1 = _mm256_cvttps_epi32(_mm256_loadu_ps(&batch.y1[i]));
+            __m256i bx2 = _mm256_cvttps_epi32(_mm256_loadu_ps(&batch.x2[i]));
+            __m256i by2 = _mm256_cvttps_epi32(_mm256_loadu_ps(&batch.y2[i]));
+            __m256i overlap = _mm256_and_si256(_mm256_and_si256(_mm256_cmpgt_epi32(bx2, ax1), _mm256_cmpgt_epi32(ax2, bx1)),
+                                               _mm256_and_si256(_mm256_cmpgt_epi32(ay1, by2), _mm256_cmpgt_epi32(by1, ay2)));
+            int mask = _mm256_movemask_ps(_mm256_castsi256_ps(overlap));
+            if (mask == 0) continue;
+
+            __m256i dx = (vectorDirection.x == 1) ? _mm256_sub_epi32(ax2, bx1) :
+                         (vectorDirection.x == -1) ? _mm256_sub_epi32(ax1, bx2) : _mm256_setzero_si256();
+            __m256i dy = (vectorDirection.y == 1) ? _mm256_sub_epi32(ay1, by2) :
+                         (vectorDirection.y == -1) ? _mm256_sub_epi32(ay2, by1) : _mm256_setzero_si256();
+            _mm256_store_si256(reinterpret_cast<__m256i*>(depthX), dx);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(depthY), dy);
+            for (int lane = 0; lane < 8; lane++) {
+                if ((mask & (1 << lane)) == 0) continue;
+                hitIndexes[hits] = uint32_t(i + lane);
+                penetrations[hits].depth.x = int16_t(depthX[lane]);
+                penetrations[hits].depth.y = int16_t(depthY[lane]);
+                hits++;
             }
-
-            if(current_position_collides) {
-                std::cout << " >>> current position collides <<<\n";
-                start_x = prev_start_x;
-                start_y = prev_start_y;
-                end_x = current_x;
-                end_y = current_y;
-            } else {
-                std::cout << " >>> current position NOT collides <<<\n";
-                prev_start_x = start_x;
-                prev_start_y = start_y;
-                start_x = current_x;
-                start_y = current_y;
+        }
+#elif defined(__SSE2__) || defined(_M_X64)
+        const __m128i ax1 = _mm_set1_epi32(a_x1), ay1 = _mm_set1_epi32(a_y1);
+        const __m128i ax2 = _mm_set1_epi32(a_x2), ay2 = _mm_set1_epi32(a_y2);
+        alignas(16) int32_t depthX[4], depthY[4];
+        for (; i < batch.paddedCount(); i += 4) {
+            __m128i bx1 = _mm_cvttps_epi32(_mm_loadu_ps(&batch.x1[i]));
+            __m128i by1 = _mm_cvttps_epi32(_mm_loadu_ps(&batch.y1[i]));
+            __m128i bx2 = _mm_cvttps_epi32(_mm_loadu_ps(&batch.x2[i]));
+            __m128i by2 = _mm_cvttps_epi32(_mm_loadu_ps(&batch.y2[i]));
+            __m128i overlap = _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi32(bx2, ax1), _mm_cmpgt_epi32(ax2, bx1)),
+                                            _mm_and_si128(_mm_cmpgt_epi32(ay1, by2), _mm_cmpgt_epi32(by1, ay2)));
+            int mask = _mm_movemask_ps(_mm_castsi128_ps(overlap));
+            if (mask == 0) continue;
+
+            __m128i dx = (vectorDirection.x == 1) ? _mm_sub_epi32(ax2, bx1) :
+                         (vectorDirection.x == -1) ? _mm_sub_epi32(ax1, bx2) : _mm_setzero_si128();
+            __m128i dy = (vectorDirection.y == 1) ? _mm_sub_epi32(ay1, by2) :
+                         (vectorDirection.y == -1) ? _mm_sub_epi32(ay2, by1) : _mm_setzero_si128();
+            _mm_store_si128(reinterpret_cast<__m128i*>(depthX), dx);
+            _mm_store_si128(reinterpret_cast<__m128i*>(depthY), dy);
+            for (int lane = 0; lane < 4; lane++) {
+                if ((mask & (1 << lane)) == 0) continue;
+                hitIndexes[hits] = uint32_t(i + lane);
+                penetrations[hits].depth.x = int16_t(depthX[lane]);
+                penetrations[hits].depth.y = int16_t(depthY[lane]);
+                hits++;
             }
+        }
+#endif
+
+        // Scalar fallback, the SIMD paths leave nothing here since the batch is padded
+        for (; i < batch.count; i++) {
+            int32_t b_x1 = int32_t(batch.x1[i]);
+            int32_t b_y1 = int32_t(batch.y1[i]);
+            int32_t b_x2 = int32_t(batch.x2[i]);
+            int32_t b_y2 = int32_t(batch.y2[i]);
+            if (!((a_x1 < b_x2) && (a_x2 > b_x1) && (a_y1 > b_y2) && (a_y2 < b_y1))) continue;
+
+            hitIndexes[hits] = uint32_t(i);
+            penetrations[hits].depth.x = int16_t((vectorDirection.x == 1) ? (a_x2 - b_x1) : (vectorDirection.x == -1) ? (a_x1 - b_x2) : 0);
+            penetrations[hits].depth.y = int16_t((vectorDirection.y == 1) ? (a_y1 - b_y2) : (vectorDirection.y == -1) ? (a_y2 - b_y1) : 0);
+            hits++;
+        }
+        return hits;
+    }
+
+    // Slab test of the moving bounds (x1 left, y1 top, x2 right, y2 bottom) along the displacement. Boxes only
+    // collide when they overlap strictly, so at the time of impact they are touching and not colliding.
+    static bool sweepBounds(float x1, float y1, float x2, float y2, float displacementX, float displacementY,
+                            const Box2 &target, SweepResult &result) {
+        const float infinity = std::numeric_limits<float>::infinity();
+        float entryX, exitX, entryY, exitY;
+
+        if (displacementX > 0.0f) {
+            entryX = (target.x1 - x2) / displacementX;
+            exitX = (target.x2 - x1) / displacementX;
+        } else if (displacementX < 0.0f) {
+            entryX = (target.x2 - x1) / displacementX;
+            exitX = (target.x1 - x2) / displacementX;
+        } else if ((x1 < target.x2) && (x2 > target.x1)) {
+            entryX = -infinity;
+            exitX = infinity;
+        } else {
+            return false;
+        }
 
-            if(abs(start_x - end_x) <= 0.0001f) {
-                std::cout << " >>> DONE <<<\n";
-                position_of_no_collision_found = true;
+        if (displacementY > 0.0f) {
+            entryY = (target.y2 - y1) / displacementY;
+            exitY = (target.y1 - y2) / displacementY;
+        } else if (displacementY < 0.0f) {
+            entryY = (target.y1 - y2) / displacementY;
+            exitY = (target.y2 - y1) / displacementY;
+        } else if ((y2 < target.y1) && (y1 > target.y2)) {
+            entryY = -infinity;
+            exitY = infinity;
+        } else {
+            return false;
+        }
+
+        float entry = std::max(entryX, entryY);
+        float exit = std::min(exitX, exitY);
+
+        // Pairs already overlapping at the start are left to the penetration resolution
+        if ((entry >= exit) || (entry < 0.0f) || (entry >= result.time)) return false;
+
+        result.hit = true;
+        result.time = entry;
+        if (entryX > entryY) {
+            result.normalX = (displacementX > 0.0f) ? -1 : 1;
+            result.normalY = 0;
+        } else {
+            result.normalX = 0;
+            result.normalY = (displacementY > 0.0f) ? -1 : 1;
+        }
+        return true;
+    }
+
+    bool CollisionDetector::sweepBox(const Box2 &moving, float displacementX, float displacementY,
+                                     const Box2 &target, SweepResult &result) {
+        return sweepBounds(moving.x1, moving.y1, moving.x2, moving.y2, displacementX, displacementY, target, result);
+    }
+
+    SweepResult CollisionDetector::updateWithNonCollidingPosition(const std::vector<const collision::Box2*> &targetBoxes,
+                                                                  const std::vector<const collision::Box2*> &movingBoxes,
+                                                                  Position &position) {
+        SweepResult result;
+        float initialX = position.GetPrevX();
+        float initialY = position.GetPrevY();
+        float displacementX = position.GetRealX() - initialX;
+        float displacementY = position.GetRealY() - initialY;
+        if ((displacementX == 0.0f) && (displacementY == 0.0f)) return result;
+
+        // The moving boxes are at the current position, sweep them from the previous one
+        bool overlapAtEnd = false;
+        for (const Box2 *moving : movingBoxes) {
+            for (const Box2 *target : targetBoxes) {
+                sweepBounds(moving->x1 - displacementX, moving->y1 - displacementY, moving->x2 - displacementX,
+                            moving->y2 - displacementY, displacementX, displacementY, *target, result);
+                overlapAtEnd = overlapAtEnd || moving->overlaps(*target);
             }
         }
 
-        std::cout << " >>> RESULT CURRENT_X: " << current_x << " CURRENT_Y: " << current_y << " \n";
-        position.setXY(current_x, current_y);
+        // Colliding at the end without any impact along the way means the boxes already overlapped at the
+        // start: go back to the previous position
+        if (!result.hit) {
+            if (!overlapAtEnd) return result;
+            result.time = 0.0f;
+        }
+
+        position.setXY(initialX + displacementX * result.time, initialY + displacementY * result.time);
+        return result;
     }
 } // namespace collision
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <collision/algorithm/CollisionDetector.h>
+#include <collision/algorithm/Penetration.h>
+#include <collision/geometry/Box2.h>
+#include <collision/geometry/BoxBatch.h>
+#include <collision/structures/vec2.hpp>
+
+namespace collision {
+
+    enum ContactEvent: uint8_t { CONTACT_EVENT_NONE = 0, CONTACT_EVENT_GROUNDED = 1, CONTACT_EVENT_AIRBORNE = 2 };
+
+    // Contacts of one body (the player) kept from frame to frame.
+    // The static candidates (terrain) are gathered once inside a box fattened by margin around the body and reused
+    // while the body stays inside it and the static world keeps its revision. Dynamic candidates are added every
+    // frame. The narrow phase is skipped altogether when the body, its direction and the candidates are the same as
+    // in the previous frame, so standing still costs a few compares. Also tracks the objects under the feet of the
+    // body (its ground) and reports when it lands on them or leaves them.
+    template <class T>
+    class ContactCache {
+    public:
+        struct Contact { T object; Penetration penetration; };
+
+        explicit ContactCache(float margin) : margin(margin) {}
+
+        // Starts a frame with the solid boxes of the body. Returns true if the static candidates are stale and must be
+        // added again with addStaticCandidate for every static box overlapping fatBox().
+        bool beginFrame(const std::vector<Box2> &boxes, uint32_t staticRevision) {
+            bodyChanged = (boxes.size() != bodyBoxes.size()) ||
+                          (!boxes.empty() && std::memcmp(boxes.data(), bodyBoxes.data(), boxes.size() * sizeof(Box2)) != 0);
+            bodyBoxes = boxes;
+            previousDynamicCount = dynamicCount;
+            dynamicCount = 0;
+            if (bodyBoxes.empty()) return false;
+
+            Box2 reach = groundProbe();
+            for (const Box2 &box : bodyBoxes) reach = reach.merged(box);
+            if (staticValid && (staticRevision == revision) && fat.contains(reach)) {
+                // Drop last frame's dynamic candidates
+                candidates.truncate(staticCount);
+                candidateObjects.resize(staticCount);
+                return false;
+            }
+
+            fat = { reach.x1 - margin, reach.y1 + margin, reach.x2 + margin, reach.y2 - margin };
+            revision = staticRevision;
+            staticValid = true;
+            staticChanged = true;
+            candidates.clear();
+            candidateObjects.clear();
+            staticCount = 0;
+            return true;
+        }
+
+        const Box2 &fatBox() const {
+            return fat;
+        }
+
+        void addStaticCandidate(T object, const Box2 &box) {
+            candidates.push(box);
+            candidateObjects.push_back(object);
+            staticCount++;
+        }
+
+        void addDynamicCandidate(T object, const Box2 &box) {
+            candidates.push(box);
+            candidateObjects.push_back(object);
+            dynamicCount++;
+        }
+
+        // Narrow phase of the body against the candidates, only when something changed since the previous frame.
+        // Returns the ground transition of this frame, if any.
+        ContactEvent update(CollisionDetector &detector, const vec2<int16_t> &direction) {
+            if (bodyBoxes.empty()) return CONTACT_EVENT_NONE;
+            bool sameDirection = (direction.x == lastDirection.x) && (direction.y == lastDirection.y);
+            if (!bodyChanged && !staticChanged && sameDirection && (dynamicCount == 0) && (previousDynamicCount == 0)) {
+                return CONTACT_EVENT_NONE;
+            }
+            staticChanged = false;
+            lastDirection = direction;
+
+            contactList.clear();
+            hitIndexes.resize(candidates.count);
+            hitPenetrations.resize(candidates.count);
+            for (const Box2 &box : bodyBoxes) {
+                uint32_t hits = detector.checkCollisionBatch(box, candidates, direction, hitIndexes.data(), hitPenetrations.data());
+                for (uint32_t i = 0; i < hits; i++) contactList.push_back({candidateObjects[hitIndexes[i]], hitPenetrations[i]});
+            }
+
+            // Objects touching or overlapping the bottom edge of the body
+            ground.clear();
+            vec2<int16_t> noDirection(0, 0);
+            uint32_t hits = detector.checkCollisionBatch(groundProbe(), candidates, noDirection, hitIndexes.data(), hitPenetrations.data());
+            for (uint32_t i = 0; i < hits; i++) {
+                T object = candidateObjects[hitIndexes[i]];
+                if ((ground.empty()) || (ground.back() != object)) ground.push_back(object);
+            }
+
+            bool wasGrounded = grounded;
+            grounded = !ground.empty();
+            if (grounded == wasGrounded) return CONTACT_EVENT_NONE;
+            return grounded ? CONTACT_EVENT_GROUNDED : CONTACT_EVENT_AIRBORNE;
+        }
+
+        const std::vector<Contact> &contacts() const {
+            return contactList;
+        }
+
+        const std::vector<T> &groundObjects() const {
+            return ground;
+        }
+
+        bool isGrounded() const {
+            return grounded;
+        }
+
+    private:
+        float margin;
+        std::vector<Box2> bodyBoxes;
+        bool bodyChanged = true;
+        vec2<int16_t> lastDirection;
+
+        Box2 fat = { 0.0f, 0.0f, 0.0f, 0.0f };
+        uint32_t revision = 0;
+        bool staticValid = false;
+        bool staticChanged = true;
+        size_t staticCount = 0;
+        size_t dynamicCount = 0;
+        size_t previousDynamicCount = 0;
+        BoxBatch candidates;
+        std::vector<T> candidateObjects;
+
+        std::vector<Contact> contactList;
+        std::vector<T> ground;
+        bool grounded = false;
+        std::vector<uint32_t> hitIndexes;
+        std::vector<Penetration> hitPenetrations;
+
+        // One pixel strip around the bottom edge of the body
+        Box2 groundProbe() const {
+            Box2 feet = bodyBoxes[0];
+            for (const Box2 &box : bodyBoxes) feet = feet.merged(box);
+            return { feet.x1, feet.y2 + 1.0f, feet.x2, feet.y2 - 1.0f };
+        }
+    };
+
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+
+namespace collision
+{
+  // Time of impact of a box moving along a displacement: fraction of the displacement in [0, 1] travelled
+  // before touching the target and normal of the touched face, pointing away from the target (-1, 0 or 1 per axis)
+  struct SweepResult
+  {
+      bool hit = false;
+      float time = 1.0f;
+      int8_t normalX = 0;
+      int8_t normalY = 0;
+  };
+}
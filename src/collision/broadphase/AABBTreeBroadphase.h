@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+#include <AABB/AABB.h>
+#include <collision/broadphase/Broadphase.h>
+
+namespace collision {
+
+    // Dynamic AABB tree broad phase (fattened bounds, incremental updates). Suits objects that move every frame.
+    template <class T>
+    class AABBTreeBroadphase : public Broadphase<T> {
+    public:
+        AABBTreeBroadphase() : tree(2), lowerBound(2), upperBound(2), queryAABB(2) {}
+
+        // The handles are the tree nodes, so the particle map of aabb::Tree is never used
+        BroadphaseHandle insert(T object, const Bounds2 &bounds) override {
+            setBounds(bounds);
+            return tree.insertParticleNode(object, lowerBound, upperBound);
+        }
+
+        void remove(BroadphaseHandle handle) override {
+            tree.removeParticleNode(handle);
+        }
+
+        void update(BroadphaseHandle handle, const Bounds2 &bounds) override {
+            setBounds(bounds);
+            tree.updateParticleNode(handle, lowerBound, upperBound);
+        }
+
+        bool queryCallback(const Bounds2 &bounds, bool (*visitor)(T, void*), void *userData) override {
+            queryAABB.lowerBound[0] = bounds.lowerX;
+            queryAABB.lowerBound[1] = bounds.lowerY;
+            queryAABB.upperBound[0] = bounds.upperX;
+            queryAABB.upperBound[1] = bounds.upperY;
+            return tree.queryVisit(queryAABB, [visitor, userData](T object) { return visitor(object, userData); }, stack);
+        }
+
+        uint32_t size() override {
+            return tree.nParticles();
+        }
+
+        void clear() override {
+            tree.removeAll();
+        }
+
+    private:
+        aabb::Tree<T> tree;
+        std::vector<double> lowerBound, upperBound;
+        aabb::AABB queryAABB;
+        std::vector<unsigned int> stack; // traversal scratch reused by every query
+
+        void setBounds(const Bounds2 &bounds) {
+            lowerBound[0] = bounds.lowerX;
+            lowerBound[1] = bounds.lowerY;
+            upperBound[0] = bounds.upperX;
+            upperBound[1] = bounds.upperY;
+        }
+    };
+
+}
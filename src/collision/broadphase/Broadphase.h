@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+
+namespace collision {
+
+    // Axis aligned bounds used by the broad phase. Touching bounds count as overlapping.
+    struct Bounds2 {
+        float lowerX, lowerY, upperX, upperY;
+
+        bool overlaps(const Bounds2 &other) const {
+            return (lowerX <= other.upperX) && (upperX >= other.lowerX) && (lowerY <= other.upperY) && (upperY >= other.lowerY);
+        }
+    };
+
+    // Handle returned by insert. The owner keeps it so remove and update are direct array accesses.
+    typedef int32_t BroadphaseHandle;
+    const BroadphaseHandle NULL_BROADPHASE_HANDLE = -1;
+
+    // Common interface of the broad phase structures used to find collision candidates
+    template <class T>
+    class Broadphase {
+    public:
+        virtual ~Broadphase() {}
+
+        virtual BroadphaseHandle insert(T object, const Bounds2 &bounds) = 0;
+
+        virtual void remove(BroadphaseHandle handle) = 0;
+
+        virtual void update(BroadphaseHandle handle, const Bounds2 &bounds) = 0;
+
+        // Inserts count objects at once (a whole row of the map) writing their handles to handles[0..count).
+        // Structures that can build in bulk override it.
+        virtual void insertBatch(const T *objects, const Bounds2 *bounds, uint32_t count, BroadphaseHandle *handles) {
+            for (uint32_t i = 0; i < count; i++) handles[i] = insert(objects[i], bounds[i]);
+        }
+
+        virtual void removeBatch(const BroadphaseHandle *handles, uint32_t count) {
+            for (uint32_t i = 0; i < count; i++) remove(handles[i]);
+        }
+
+        // Calls visitor(object, userData) for every object whose bounds overlap the given bounds until it returns
+        // false. Returns false when the query was stopped early. Allocates nothing.
+        virtual bool queryCallback(const Bounds2 &bounds, bool (*visitor)(T, void*), void *userData) = 0;
+
+        // Same as queryCallback for any callable taking T and returning bool (false stops the query)
+        template <class Fn>
+        bool queryVisit(const Bounds2 &bounds, Fn &&fn) {
+            return queryCallback(bounds, [](T object, void *userData) { return (*static_cast<typename std::remove_reference<Fn>::type*>(userData))(object); }, &fn);
+        }
+
+        // Appends to results every object whose bounds overlap the given bounds
+        void query(const Bounds2 &bounds, std::vector<T> &results) {
+            queryVisit(bounds, [&results](T object) { results.push_back(object); return true; });
+        }
+
+        virtual uint32_t size() = 0;
+
+        virtual void clear() = 0;
+    };
+
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <cmath>
+#include <collision/broadphase/Broadphase.h>
+
+namespace collision {
+
+    // Uniform grid broad phase. Objects are stored in every cell they overlap, so looking up the objects
+    // of a cell is O(1). Best suited to objects laid on a fixed grid like the terrain of the world map.
+    template <class T>
+    class SpatialHashGrid : public Broadphase<T> {
+    public:
+        SpatialHashGrid(float cellWidth, float cellHeight) : cellWidth(cellWidth), cellHeight(cellHeight) {}
+
+        // The handles are indexes in the entries array
+        BroadphaseHandle insert(T object, const Bounds2 &bounds) override {
+            uint32_t index;
+            if (!freeEntries.empty()) {
+                index = freeEntries.back();
+                freeEntries.pop_back();
+            } else {
+                index = entries.size();
+                entries.emplace_back();
+            }
+
+            Entry &entry = entries[index];
+            entry.object = object;
+            entry.bounds = bounds;
+            entry.queryStamp = queryStamp;
+            cellRange(bounds, entry.cellX1, entry.cellY1, entry.cellX2, entry.cellY2);
+            addToCells(index);
+            return index;
+        }
+
+        void remove(BroadphaseHandle index) override {
+            removeFromCells(index);
+            freeEntries.push_back(index);
+        }
+
+        void insertBatch(const T *objects, const Bounds2 *bounds, uint32_t count, BroadphaseHandle *handles) override {
+            entries.reserve(entries.size() + count);
+            for (uint32_t i = 0; i < count; i++) handles[i] = insert(objects[i], bounds[i]);
+        }
+
+        void update(BroadphaseHandle index, const Bounds2 &bounds) override {
+            Entry &entry = entries[index];
+            entry.bounds = bounds;
+
+            // Only touch the cells when the object moved to other cells
+            int32_t cellX1, cellY1, cellX2, cellY2;
+            cellRange(bounds, cellX1, cellY1, cellX2, cellY2);
+            if ((cellX1 != entry.cellX1) || (cellY1 != entry.cellY1) || (cellX2 != entry.cellX2) || (cellY2 != entry.cellY2)) {
+                removeFromCells(index);
+                entry.cellX1 = cellX1;
+                entry.cellY1 = cellY1;
+                entry.cellX2 = cellX2;
+                entry.cellY2 = cellY2;
+                addToCells(index);
+            }
+        }
+
+        // Visits every object whose bounds overlap the given bounds until fn returns false
+        template <class Fn>
+        bool queryVisit(const Bounds2 &bounds, Fn &&fn) {
+            int32_t cellX1, cellY1, cellX2, cellY2;
+            cellRange(bounds, cellX1, cellY1, cellX2, cellY2);
+
+            // Objects stored in several cells are reported once
+            queryStamp++;
+            for (int32_t cellY = cellY1; cellY <= cellY2; cellY++) {
+                for (int32_t cellX = cellX1; cellX <= cellX2; cellX++) {
+                    auto it = cells.find(cellKey(cellX, cellY));
+                    if (it == cells.end()) continue;
+
+                    for (uint32_t index : it->second) {
+                        Entry &entry = entries[index];
+                        if (entry.queryStamp == queryStamp) continue;
+                        entry.queryStamp = queryStamp;
+                        if (entry.bounds.overlaps(bounds) && !fn(entry.object)) return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        bool queryCallback(const Bounds2 &bounds, bool (*visitor)(T, void*), void *userData) override {
+            return queryVisit(bounds, [visitor, userData](T object) { return visitor(object, userData); });
+        }
+
+        uint32_t size() override {
+            return entries.size() - freeEntries.size();
+        }
+
+        void clear() override {
+            cells.clear();
+            entries.clear();
+            freeEntries.clear();
+        }
+
+    private:
+        struct Entry {
+            T object;
+            Bounds2 bounds;
+            int32_t cellX1, cellY1, cellX2, cellY2;
+            uint32_t queryStamp;
+        };
+
+        float cellWidth, cellHeight;
+        std::unordered_map<uint64_t, std::vector<uint32_t>> cells;
+        std::vector<Entry> entries;
+        std::vector<uint32_t> freeEntries;
+        uint32_t queryStamp = 0;
+
+        static uint64_t cellKey(int32_t cellX, int32_t cellY) {
+            return (uint64_t(uint32_t(cellX)) << 32) | uint32_t(cellY);
+        }
+
+        void cellRange(const Bounds2 &bounds, int32_t &cellX1, int32_t &cellY1, int32_t &cellX2, int32_t &cellY2) {
+            cellX1 = int32_t(std::floor(bounds.lowerX / cellWidth));
+            cellY1 = int32_t(std::floor(bounds.lowerY / cellHeight));
+            cellX2 = int32_t(std::floor(bounds.upperX / cellWidth));
+            cellY2 = int32_t(std::floor(bounds.upperY / cellHeight));
+        }
+
+        void addToCells(uint32_t index) {
+            Entry &entry = entries[index];
+            for (int32_t cellY = entry.cellY1; cellY <= entry.cellY2; cellY++) {
+                for (int32_t cellX = entry.cellX1; cellX <= entry.cellX2; cellX++) {
+                    cells[cellKey(cellX, cellY)].push_back(index);
+                }
+            }
+        }
+
+        void removeFromCells(uint32_t index) {
+            Entry &entry = entries[index];
+            for (int32_t cellY = entry.cellY1; cellY <= entry.cellY2; cellY++) {
+                for (int32_t cellX = entry.cellX1; cellX <= entry.cellX2; cellX++) {
+                    auto it = cells.find(cellKey(cellX, cellY));
+                    if (it == cells.end()) continue;
+
+                    std::vector<uint32_t> &cell = it->second;
+                    for (size_t i = 0; i < cell.size(); i++) {
+                        if (cell[i] == index) {
+                            cell[i] = cell.back();
+                            cell.pop_back();
+                            break;
+                        }
+                    }
+                    if (cell.empty()) cells.erase(it);
+                }
+            }
+        }
+    };
+
+}
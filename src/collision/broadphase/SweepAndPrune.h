@@ -0,0 +1,171 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <collision/broadphase/Broadphase.h>
+
+namespace collision {
+
+    // Incremental sort and sweep broad phase on the Y axis, the axis the objects of a vertical level spread along.
+    // Objects are kept sorted by their lower Y bound. Moving an object swaps it with its neighbours until the order
+    // is restored (insertion sort), a few swaps at most between two frames. A query binary searches the first object
+    // that could reach the bounds and sweeps up to their upper Y bound, and all the overlapping pairs are found with a
+    // single sweep of the list. Suited to many mobile bodies, where the tree keeps reinserting the bodies that leave
+    // their fattened bounds.
+    template <class T>
+    class SweepAndPrune : public Broadphase<T> {
+    public:
+        // The handles are indexes in the entries array, which keeps the rank of every object in the sorted list
+        BroadphaseHandle insert(T object, const Bounds2 &bounds) override {
+            uint32_t index = allocate(object);
+            entries[index].rank = slots.size();
+            slots.push_back({ bounds, index });
+            grow(bounds);
+            sortDown(entries[index].rank);
+            return index;
+        }
+
+        void remove(BroadphaseHandle index) override {
+            removeBatch(&index, 1);
+        }
+
+        // The new slots are sorted on their own and merged into the list, instead of sorted one by one
+        void insertBatch(const T *objects, const Bounds2 *bounds, uint32_t count, BroadphaseHandle *handles) override {
+            slots.reserve(slots.size() + count);
+            uint32_t firstRank = slots.size();
+            for (uint32_t i = 0; i < count; i++) {
+                uint32_t index = allocate(objects[i]);
+                slots.push_back({ bounds[i], index });
+                grow(bounds[i]);
+                handles[i] = index;
+            }
+            auto byLowerY = [](const Slot &slot1, const Slot &slot2) { return slot1.bounds.lowerY < slot2.bounds.lowerY; };
+            std::sort(slots.begin() + firstRank, slots.end(), byLowerY);
+            std::inplace_merge(slots.begin(), slots.begin() + firstRank, slots.end(), byLowerY);
+            for (uint32_t rank = 0; rank < slots.size(); rank++) entries[slots[rank].entry].rank = rank;
+        }
+
+        // Removed slots are dropped in a single compaction of the list
+        void removeBatch(const BroadphaseHandle *handles, uint32_t count) override {
+            for (uint32_t i = 0; i < count; i++) {
+                slots[entries[handles[i]].rank].entry = REMOVED;
+                freeEntries.push_back(handles[i]);
+            }
+            uint32_t kept = 0;
+            for (uint32_t rank = 0; rank < slots.size(); rank++) {
+                if (slots[rank].entry == REMOVED) continue;
+                slots[kept] = slots[rank];
+                entries[slots[kept].entry].rank = kept;
+                kept++;
+            }
+            slots.resize(kept);
+        }
+
+        void update(BroadphaseHandle index, const Bounds2 &bounds) override {
+            uint32_t rank = entries[index].rank;
+            float previousLowerY = slots[rank].bounds.lowerY;
+            slots[rank].bounds = bounds;
+            grow(bounds);
+            if (bounds.lowerY < previousLowerY) sortDown(rank);
+            else if (bounds.lowerY > previousLowerY) sortUp(rank);
+        }
+
+        // Visits every object whose bounds overlap the given bounds until fn returns false
+        template <class Fn>
+        bool queryVisit(const Bounds2 &bounds, Fn &&fn) {
+            // No object starting below lowerY - maxHeight can reach the bounds
+            float fromY = bounds.lowerY - maxHeight;
+            auto first = std::lower_bound(slots.begin(), slots.end(), fromY, [](const Slot &slot, float y) {
+                return slot.bounds.lowerY < y;
+            });
+            for (auto it = first; (it != slots.end()) && (it->bounds.lowerY <= bounds.upperY); ++it) {
+                if (it->bounds.overlaps(bounds) && !fn(entries[it->entry].object)) return false;
+            }
+            return true;
+        }
+
+        bool queryCallback(const Bounds2 &bounds, bool (*visitor)(T, void*), void *userData) override {
+            return queryVisit(bounds, [visitor, userData](T object) { return visitor(object, userData); });
+        }
+
+        // Calls fn(a, b) once for every pair of objects with overlapping bounds until it returns false
+        template <class Fn>
+        bool visitPairs(Fn &&fn) {
+            for (size_t i = 0; i < slots.size(); i++) {
+                const Bounds2 &bounds = slots[i].bounds;
+                for (size_t j = i + 1; (j < slots.size()) && (slots[j].bounds.lowerY <= bounds.upperY); j++) {
+                    if (slots[j].bounds.overlaps(bounds) && !fn(entries[slots[i].entry].object, entries[slots[j].entry].object)) return false;
+                }
+            }
+            return true;
+        }
+
+        uint32_t size() override {
+            return slots.size();
+        }
+
+        void clear() override {
+            slots.clear();
+            entries.clear();
+            freeEntries.clear();
+            maxHeight = 0.0f;
+        }
+
+    private:
+        static const uint32_t REMOVED = UINT32_MAX;
+
+        struct Slot {
+            Bounds2 bounds;
+            uint32_t entry;
+        };
+
+        struct Entry {
+            T object;
+            uint32_t rank;
+        };
+
+        std::vector<Slot> slots; // sorted by bounds.lowerY
+        std::vector<Entry> entries;
+        std::vector<uint32_t> freeEntries;
+        float maxHeight = 0.0f; // height of the tallest bounds stored since the last clear
+
+        uint32_t allocate(T object) {
+            uint32_t index;
+            if (!freeEntries.empty()) {
+                index = freeEntries.back();
+                freeEntries.pop_back();
+            } else {
+                index = entries.size();
+                entries.emplace_back();
+            }
+            entries[index].object = object;
+            return index;
+        }
+
+        void grow(const Bounds2 &bounds) {
+            maxHeight = std::max(maxHeight, bounds.upperY - bounds.lowerY);
+        }
+
+        void swapSlots(uint32_t rank1, uint32_t rank2) {
+            std::swap(slots[rank1], slots[rank2]);
+            entries[slots[rank1].entry].rank = rank1;
+            entries[slots[rank2].entry].rank = rank2;
+        }
+
+        void sortDown(uint32_t rank) {
+            while ((rank > 0) && (slots[rank - 1].bounds.lowerY > slots[rank].bounds.lowerY)) {
+                swapSlots(rank - 1, rank);
+                rank--;
+            }
+        }
+
+        void sortUp(uint32_t rank) {
+            while ((rank + 1 < slots.size()) && (slots[rank + 1].bounds.lowerY < slots[rank].bounds.lowerY)) {
+                swapSlots(rank, rank + 1);
+                rank++;
+            }
+        }
+    };
+
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <collision/broadphase/Broadphase.h>
+#include <collision/geometry/Box2.h>
+
+namespace collision {
+
+    // Solid tiles of a cell map (up to 32 columns): one bit per cell and row plus, for every set cell, its owner,
+    // its bounds and its solid box, so the narrow phase reads the boxes straight from the map.
+    // Rows are addressed by their index in the level (row = floor(y / cellHeight), y growing upwards) and kept in a
+    // ring of fixed size: streaming rows in and out only clears and sets bits, it never allocates.
+    template <class T>
+    class TileLayer {
+    public:
+        static const uint16_t MAX_COLUMNS = 32;
+
+        // maxRows is the number of rows alive at once, rounded up to a power of two
+        TileLayer(uint16_t cellWidth, uint16_t cellHeight, uint16_t columns, uint32_t maxRows) :
+                cellWidth(cellWidth), cellHeight(cellHeight), columns((columns < MAX_COLUMNS) ? columns : uint16_t(MAX_COLUMNS)) {
+            uint32_t ringSize = 1;
+            while (ringSize < maxRows) ringSize <<= 1;
+            rows.resize(ringSize);
+            rowMask = ringSize - 1;
+        }
+
+        // Cell of a tile placed at the given level position. Returns false if it's outside the map.
+        bool cellAt(float x, float y, int32_t &row, int32_t &column) const {
+            row = int32_t(std::floor(y / cellHeight));
+            column = int32_t(std::floor(x / cellWidth));
+            return (row >= 0) && (column >= 0) && (column < columns);
+        }
+
+        // Handle of the cell, unique while the row is alive
+        BroadphaseHandle handleOf(int32_t row, int32_t column) const {
+            return row * MAX_COLUMNS + column;
+        }
+
+        // Bounds and solid box in level coordinates. The row replaces whatever older row used its ring slot.
+        BroadphaseHandle setTile(int32_t row, int32_t column, T object, const Bounds2 &bounds, const Box2 &box) {
+            Row &tileRow = rows[row & rowMask];
+            if (tileRow.index != row) {
+                tileRow.index = row;
+                tileRow.solidMask = 0;
+            }
+            tileRow.solidMask |= (uint32_t(1) << column);
+            tileRow.objects[column] = object;
+            tileRow.bounds[column] = bounds;
+            tileRow.boxes[column] = box;
+            return handleOf(row, column);
+        }
+
+        void clearTile(BroadphaseHandle handle) {
+            int32_t row = handle / MAX_COLUMNS;
+            int32_t column = handle % MAX_COLUMNS;
+            Row &tileRow = rows[row & rowMask];
+            if (tileRow.index == row) tileRow.solidMask &= ~(uint32_t(1) << column);
+        }
+
+        bool isSolid(int32_t row, int32_t column) const {
+            const Row &tileRow = rows[row & rowMask];
+            return (tileRow.index == row) && (column >= 0) && (column < columns) && (tileRow.solidMask & (uint32_t(1) << column));
+        }
+
+        // Calls fn(object, solid box) for every solid tile whose box overlaps strictly the given box, in level
+        // coordinates, until fn returns false
+        template <class Fn>
+        bool visitTiles(const Box2 &box, Fn &&fn) const {
+            int32_t row1, column1, row2, column2;
+            cellRange(box.x1, box.y2, box.x2, box.y1, row1, column1, row2, column2);
+            for (int32_t row = row1; row <= row2; row++) {
+                const Row &tileRow = rows[row & rowMask];
+                if (tileRow.index != row) continue;
+                uint32_t solid = tileRow.solidMask & columnMask(column1, column2);
+                for (int32_t column = column1; solid != 0; column++) {
+                    if ((solid & (uint32_t(1) << column)) == 0) continue;
+                    solid &= ~(uint32_t(1) << column);
+                    if (tileRow.boxes[column].overlaps(box) && !fn(tileRow.objects[column], tileRow.boxes[column])) return false;
+                }
+            }
+            return true;
+        }
+
+        // Calls fn(object, solid box) for every solid tile along the segment from the origin to origin + displacement,
+        // in level coordinates, in the order the segment crosses their cells (DDA), until fn returns false. Tile boxes
+        // lay inside their cells, so the first tile hit along the walk is the nearest one.
+        template <class Fn>
+        bool visitRay(float originX, float originY, float displacementX, float displacementY, Fn &&fn) const {
+            const float infinity = std::numeric_limits<float>::infinity();
+            int32_t column = int32_t(std::floor(originX / cellWidth));
+            int32_t row = int32_t(std::floor(originY / cellHeight));
+            int32_t endColumn = int32_t(std::floor((originX + displacementX) / cellWidth));
+            int32_t endRow = int32_t(std::floor((originY + displacementY) / cellHeight));
+            int32_t stepX = (displacementX > 0.0f) ? 1 : (displacementX < 0.0f) ? -1 : 0;
+            int32_t stepY = (displacementY > 0.0f) ? 1 : (displacementY < 0.0f) ? -1 : 0;
+
+            // Fraction of the displacement where the segment crosses the next column and row boundaries
+            float nextX = (stepX > 0) ? ((column + 1) * cellWidth - originX) / displacementX :
+                          (stepX < 0) ? (column * cellWidth - originX) / displacementX : infinity;
+            float nextY = (stepY > 0) ? ((row + 1) * cellHeight - originY) / displacementY :
+                          (stepY < 0) ? (row * cellHeight - originY) / displacementY : infinity;
+            float deltaX = (stepX != 0) ? cellWidth / std::fabs(displacementX) : infinity;
+            float deltaY = (stepY != 0) ? cellHeight / std::fabs(displacementY) : infinity;
+
+            int32_t steps = std::abs(endColumn - column) + std::abs(endRow - row);
+            for (int32_t i = 0; ; i++) {
+                const Row &tileRow = rows[row & rowMask];
+                if ((tileRow.index == row) && (column >= 0) && (column < columns) &&
+                    (tileRow.solidMask & (uint32_t(1) << column)) && !fn(tileRow.objects[column], tileRow.boxes[column])) {
+                    return false;
+                }
+                if (i == steps) break;
+                if (nextX < nextY) {
+                    column += stepX;
+                    nextX += deltaX;
+                } else {
+                    row += stepY;
+                    nextY += deltaY;
+                }
+            }
+            return true;
+        }
+
+        // Calls fn(object) for every solid tile whose bounds overlap the given bounds, same semantics as the broad phase
+        template <class Fn>
+        bool queryVisit(const Bounds2 &bounds, Fn &&fn) const {
+            // Tile bounds include their upper edge, which lays on the next cell, and may spill a pixel out of their cell
+            int32_t row1, column1, row2, column2;
+            cellRange(bounds.lowerX - cellWidth, bounds.lowerY - cellHeight, bounds.upperX + cellWidth, bounds.upperY + cellHeight,
+                      row1, column1, row2, column2);
+            for (int32_t row = row1; row <= row2; row++) {
+                const Row &tileRow = rows[row & rowMask];
+                if (tileRow.index != row) continue;
+                uint32_t solid = tileRow.solidMask & columnMask(column1, column2);
+                for (int32_t column = column1; solid != 0; column++) {
+                    if ((solid & (uint32_t(1) << column)) == 0) continue;
+                    solid &= ~(uint32_t(1) << column);
+                    if (tileRow.bounds[column].overlaps(bounds) && !fn(tileRow.objects[column])) return false;
+                }
+            }
+            return true;
+        }
+
+        void clear() {
+            for (Row &tileRow : rows) {
+                tileRow.index = NO_ROW;
+                tileRow.solidMask = 0;
+            }
+        }
+
+    private:
+        static const int32_t NO_ROW = INT32_MIN;
+
+        struct Row {
+            int32_t index = NO_ROW;
+            uint32_t solidMask = 0;
+            T objects[MAX_COLUMNS];
+            Bounds2 bounds[MAX_COLUMNS];
+            Box2 boxes[MAX_COLUMNS];
+        };
+
+        float cellWidth, cellHeight;
+        int32_t columns;
+        std::vector<Row> rows;
+        uint32_t rowMask;
+
+        void cellRange(float lowerX, float lowerY, float upperX, float upperY, int32_t &row1, int32_t &column1,
+                       int32_t &row2, int32_t &column2) const {
+            row1 = int32_t(std::floor(lowerY / cellHeight));
+            row2 = int32_t(std::floor(upperY / cellHeight));
+            column1 = int32_t(std::floor(lowerX / cellWidth));
+            column2 = int32_t(std::floor(upperX / cellWidth));
+            if (column1 < 0) column1 = 0;
+            if (column2 >= columns) column2 = columns - 1;
+        }
+
+        // Bits column1..column2, empty if the range is empty
+        static uint32_t columnMask(int32_t column1, int32_t column2) {
+            if (column2 < column1) return 0;
+            uint32_t upper = (column2 >= 31) ? 0xFFFFFFFFu : ((uint32_t(1) << (column2 + 1)) - 1);
+            return upper & ~((uint32_t(1) << column1) - 1);
+        }
+    };
+
+}
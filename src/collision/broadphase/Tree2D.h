@@ -0,0 +1,503 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <cfloat>
+#include <cassert>
+#include <algorithm>
+#include <type_traits>
+#include <collision/broadphase/Broadphase.h>
+
+namespace collision {
+
+    const int32_t TREE2D_NULL_NODE = -1;
+    const uint16_t TREE2D_STACK_SIZE = 64; // depth of an AVL balanced tree stays far below this for any real scene
+
+    // Dynamic AABB tree specialized for 2D (adapted from the Box2D / aabbcc dynamic tree). Bounds are stored inline
+    // in the nodes as Scalar (float or int16_t), nodes live in a single pool with an intrusive free list and the
+    // query traversal uses a fixed size stack, so insert, update and query allocate nothing once the pool is reserved.
+    // Leaves store fattened bounds so objects moving less than the margin don't restructure the tree.
+    // insert returns a node handle that stays valid until the object is removed.
+    template <class T, class Scalar = float>
+    class Tree2D {
+    public:
+        // 32 bytes with float bounds (two nodes per cache line), 24 bytes with int16_t bounds
+        struct Node {
+            Scalar lowerX, lowerY, upperX, upperY;
+            int32_t parent; // next free node while the node is in the free list
+            int32_t left, right;
+            int32_t height; // 0 for leaves, -1 for free nodes
+        };
+
+        Tree2D(Scalar margin = 2, uint32_t initialCapacity = 16) : margin(margin) {
+            reserve(initialCapacity);
+        }
+
+        // Grows the node pool so that the given number of objects can be stored without allocating
+        void reserve(uint32_t objectCount) {
+            uint32_t nodeCount = std::max<uint32_t>(2 * objectCount, 1);
+            if (nodeCount <= nodes.size()) return;
+
+            uint32_t oldCount = nodes.size();
+            nodes.resize(nodeCount);
+            objects.resize(nodeCount);
+            for (uint32_t i = oldCount; i < nodeCount; i++) {
+                nodes[i].parent = (i + 1 < nodeCount) ? int32_t(i + 1) : freeList;
+                nodes[i].height = -1;
+            }
+            freeList = oldCount;
+        }
+
+        int32_t insert(T object, const Bounds2 &bounds) {
+            int32_t leaf = allocateNode();
+            setFattened(nodes[leaf], bounds);
+            nodes[leaf].height = 0;
+            objects[leaf] = object;
+            insertLeaf(leaf);
+            count++;
+            return leaf;
+        }
+
+        void remove(int32_t leaf) {
+            assert((leaf >= 0) && (uint32_t(leaf) < nodes.size()) && (nodes[leaf].height == 0));
+            removeLeaf(leaf);
+            freeNode(leaf);
+            count--;
+        }
+
+        // Inserts many objects at once: the leaves are sorted along a Morton curve, built into a balanced subtree
+        // and the subtree is grafted into the tree as a single node. Handles are written to handles[0..count).
+        void insertBatch(const T *batchObjects, const Bounds2 *bounds, uint32_t batchCount, int32_t *handles) {
+            if (batchCount < BATCH_MIN_SIZE) {
+                for (uint32_t i = 0; i < batchCount; i++) handles[i] = insert(batchObjects[i], bounds[i]);
+                return;
+            }
+
+            reserve(count + batchCount);
+            buildLeaves.clear();
+            for (uint32_t i = 0; i < batchCount; i++) {
+                int32_t leaf = allocateNode();
+                setFattened(nodes[leaf], bounds[i]);
+                objects[leaf] = batchObjects[i];
+                handles[i] = leaf;
+                buildLeaves.push_back({ 0, leaf });
+            }
+            count += batchCount;
+
+            int32_t subtree = buildSubtree();
+            if (root == TREE2D_NULL_NODE) {
+                root = subtree;
+                nodes[root].parent = TREE2D_NULL_NODE;
+            } else {
+                insertLeaf(subtree);
+            }
+        }
+
+        // Removes many objects at once. When most of the tree goes away the remaining leaves are rebuilt in bulk
+        // (their handles stay valid), otherwise the leaves are removed one by one.
+        void removeBatch(const int32_t *handles, uint32_t batchCount) {
+            if ((batchCount < BATCH_MIN_SIZE) || (2 * batchCount < count)) {
+                for (uint32_t i = 0; i < batchCount; i++) remove(handles[i]);
+                return;
+            }
+
+            for (uint32_t i = 0; i < batchCount; i++) {
+                assert(nodes[handles[i]].height == 0);
+                freeNode(handles[i]);
+            }
+            count -= batchCount;
+
+            // Drop every internal node and rebuild over the surviving leaves
+            buildLeaves.clear();
+            for (uint32_t i = 0; i < nodes.size(); i++) {
+                if (nodes[i].height > 0) freeNode(i);
+                else if (nodes[i].height == 0) buildLeaves.push_back({ 0, int32_t(i) });
+            }
+            root = TREE2D_NULL_NODE;
+            if (!buildLeaves.empty()) {
+                root = buildSubtree();
+                nodes[root].parent = TREE2D_NULL_NODE;
+            }
+        }
+
+        // Returns true when the bounds left the fattened bounds and the leaf was reinserted
+        bool update(int32_t leaf, const Bounds2 &bounds) {
+            assert((leaf >= 0) && (uint32_t(leaf) < nodes.size()) && (nodes[leaf].height == 0));
+            Node &node = nodes[leaf];
+            if ((node.lowerX <= toLower(bounds.lowerX)) && (node.lowerY <= toLower(bounds.lowerY)) &&
+                (node.upperX >= toUpper(bounds.upperX)) && (node.upperY >= toUpper(bounds.upperY))) {
+                return false;
+            }
+
+            removeLeaf(leaf);
+            setFattened(nodes[leaf], bounds);
+            insertLeaf(leaf);
+            return true;
+        }
+
+        // Visits the objects whose fattened bounds overlap the given bounds until fn returns false.
+        // Returns false when the query was stopped early.
+        template <class Fn>
+        bool queryVisit(const Bounds2 &bounds, Fn &&fn) const {
+            if (root == TREE2D_NULL_NODE) return true;
+
+            Scalar lowerX = toLower(bounds.lowerX), lowerY = toLower(bounds.lowerY);
+            Scalar upperX = toUpper(bounds.upperX), upperY = toUpper(bounds.upperY);
+
+            int32_t stack[TREE2D_STACK_SIZE];
+            uint16_t stackSize = 0;
+            stack[stackSize++] = root;
+            while (stackSize) {
+                int32_t index = stack[--stackSize];
+                const Node &node = nodes[index];
+                if ((node.upperX < lowerX) || (node.lowerX > upperX) || (node.upperY < lowerY) || (node.lowerY > upperY)) continue;
+
+                if (node.height == 0) {
+                    if (!fn(objects[index])) return false;
+                } else {
+                    assert(stackSize + 2 <= TREE2D_STACK_SIZE);
+                    stack[stackSize++] = node.left;
+                    stack[stackSize++] = node.right;
+                }
+            }
+            return true;
+        }
+
+        // Appends to results the objects whose fattened bounds overlap the given bounds
+        void query(const Bounds2 &bounds, std::vector<T> &results) const {
+            queryVisit(bounds, [&results](T object) { results.push_back(object); return true; });
+        }
+
+        T object(int32_t leaf) const {
+            return objects[leaf];
+        }
+
+        uint32_t size() const {
+            return count;
+        }
+
+        uint32_t height() const {
+            return (root == TREE2D_NULL_NODE) ? 0 : nodes[root].height;
+        }
+
+        // Bytes used by the node pool
+        size_t memoryUsage() const {
+            return nodes.capacity() * sizeof(Node) + objects.capacity() * sizeof(T);
+        }
+
+        void clear() {
+            uint32_t nodeCount = nodes.size();
+            for (uint32_t i = 0; i < nodeCount; i++) {
+                nodes[i].parent = (i + 1 < nodeCount) ? int32_t(i + 1) : TREE2D_NULL_NODE;
+                nodes[i].height = -1;
+            }
+            freeList = nodeCount ? 0 : TREE2D_NULL_NODE;
+            root = TREE2D_NULL_NODE;
+            count = 0;
+        }
+
+    private:
+        std::vector<Node> nodes;
+        std::vector<T> objects; // parallel to nodes, only meaningful for leaves
+        int32_t root = TREE2D_NULL_NODE;
+        int32_t freeList = TREE2D_NULL_NODE;
+        uint32_t count = 0;
+        Scalar margin;
+
+        static const uint32_t BATCH_MIN_SIZE = 8; // below this incremental insertion is as good as a bulk build
+        struct BuildLeaf { uint32_t mortonCode; int32_t node; };
+        std::vector<BuildLeaf> buildLeaves; // scratch of the bulk builds, reused between batches
+
+        // Integer bounds are rounded outwards so they always contain the float bounds
+        static Scalar toLower(float value) {
+            return std::is_integral<Scalar>::value ? Scalar(std::floor(value)) : Scalar(value);
+        }
+
+        static Scalar toUpper(float value) {
+            return std::is_integral<Scalar>::value ? Scalar(std::ceil(value)) : Scalar(value);
+        }
+
+        static Scalar perimeter(Scalar lowerX, Scalar lowerY, Scalar upperX, Scalar upperY) {
+            return 2 * ((upperX - lowerX) + (upperY - lowerY));
+        }
+
+        static Scalar perimeter(const Node &a, const Node &b) {
+            return perimeter(std::min(a.lowerX, b.lowerX), std::min(a.lowerY, b.lowerY),
+                             std::max(a.upperX, b.upperX), std::max(a.upperY, b.upperY));
+        }
+
+        static Scalar perimeter(const Node &a) {
+            return perimeter(a.lowerX, a.lowerY, a.upperX, a.upperY);
+        }
+
+        void setFattened(Node &node, const Bounds2 &bounds) {
+            node.lowerX = toLower(bounds.lowerX) - margin;
+            node.lowerY = toLower(bounds.lowerY) - margin;
+            node.upperX = toUpper(bounds.upperX) + margin;
+            node.upperY = toUpper(bounds.upperY) + margin;
+        }
+
+        void merge(Node &node, const Node &a, const Node &b) {
+            node.lowerX = std::min(a.lowerX, b.lowerX);
+            node.lowerY = std::min(a.lowerY, b.lowerY);
+            node.upperX = std::max(a.upperX, b.upperX);
+            node.upperY = std::max(a.upperY, b.upperY);
+        }
+
+        void refit(int32_t index) {
+            Node &node = nodes[index];
+            merge(node, nodes[node.left], nodes[node.right]);
+            node.height = 1 + std::max(nodes[node.left].height, nodes[node.right].height);
+        }
+
+        int32_t allocateNode() {
+            // The pool doubles when exhausted, reserve() up front to avoid it
+            if (freeList == TREE2D_NULL_NODE) reserve(nodes.size());
+
+            int32_t index = freeList;
+            freeList = nodes[index].parent;
+            nodes[index].parent = TREE2D_NULL_NODE;
+            nodes[index].left = TREE2D_NULL_NODE;
+            nodes[index].right = TREE2D_NULL_NODE;
+            nodes[index].height = 0;
+            return index;
+        }
+
+        void freeNode(int32_t index) {
+            nodes[index].parent = freeList;
+            nodes[index].height = -1;
+            freeList = index;
+        }
+
+        // Spreads the lower 16 bits of value to the even bits
+        static uint32_t spreadBits(uint32_t value) {
+            value &= 0x0000ffff;
+            value = (value | (value << 8)) & 0x00ff00ff;
+            value = (value | (value << 4)) & 0x0f0f0f0f;
+            value = (value | (value << 2)) & 0x33333333;
+            value = (value | (value << 1)) & 0x55555555;
+            return value;
+        }
+
+        // Builds a balanced subtree over buildLeaves and returns its root
+        int32_t buildSubtree() {
+            float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+            for (const BuildLeaf &buildLeaf : buildLeaves) {
+                const Node &node = nodes[buildLeaf.node];
+                float centreX = 0.5f * float(node.lowerX + node.upperX), centreY = 0.5f * float(node.lowerY + node.upperY);
+                minX = std::min(minX, centreX);
+                minY = std::min(minY, centreY);
+                maxX = std::max(maxX, centreX);
+                maxY = std::max(maxY, centreY);
+            }
+
+            float scaleX = (maxX > minX) ? 65535.0f / (maxX - minX) : 0.0f;
+            float scaleY = (maxY > minY) ? 65535.0f / (maxY - minY) : 0.0f;
+            for (BuildLeaf &buildLeaf : buildLeaves) {
+                const Node &node = nodes[buildLeaf.node];
+                float centreX = 0.5f * float(node.lowerX + node.upperX), centreY = 0.5f * float(node.lowerY + node.upperY);
+                buildLeaf.mortonCode = spreadBits(uint32_t((centreX - minX) * scaleX)) | (spreadBits(uint32_t((centreY - minY) * scaleY)) << 1);
+            }
+            std::sort(buildLeaves.begin(), buildLeaves.end(), [](const BuildLeaf &a, const BuildLeaf &b) { return a.mortonCode < b.mortonCode; });
+
+            return buildRange(0, buildLeaves.size());
+        }
+
+        // Median split of the Morton ordered leaves, so the subtree is balanced and stays valid for the AVL rotations
+        int32_t buildRange(uint32_t begin, uint32_t end) {
+            if (end - begin == 1) return buildLeaves[begin].node;
+
+            uint32_t middle = begin + (end - begin) / 2;
+            int32_t left = buildRange(begin, middle);
+            int32_t right = buildRange(middle, end);
+
+            int32_t parent = allocateNode();
+            nodes[parent].left = left;
+            nodes[parent].right = right;
+            nodes[left].parent = parent;
+            nodes[right].parent = parent;
+            refit(parent);
+            return parent;
+        }
+
+        void insertLeaf(int32_t leaf) {
+            if (root == TREE2D_NULL_NODE) {
+                root = leaf;
+                nodes[root].parent = TREE2D_NULL_NODE;
+                return;
+            }
+
+            // Find the best sibling by the perimeter heuristic
+            const Node &leafNode = nodes[leaf];
+            int32_t index = root;
+            while (nodes[index].height > 0) {
+                const Node &node = nodes[index];
+                Scalar area = perimeter(node);
+                Scalar combinedArea = perimeter(node, leafNode);
+                Scalar cost = 2 * combinedArea;
+                Scalar inheritanceCost = 2 * (combinedArea - area);
+
+                const Node &left = nodes[node.left];
+                Scalar costLeft = perimeter(left, leafNode) + inheritanceCost;
+                if (left.height > 0) costLeft -= perimeter(left);
+
+                const Node &right = nodes[node.right];
+                Scalar costRight = perimeter(right, leafNode) + inheritanceCost;
+                if (right.height > 0) costRight -= perimeter(right);
+
+                if ((cost < costLeft) && (cost < costRight)) break;
+                index = (costLeft < costRight) ? node.left : node.right;
+            }
+
+            // Create a new parent for the sibling and the leaf
+            int32_t sibling = index;
+            int32_t oldParent = nodes[sibling].parent;
+            int32_t newParent = allocateNode();
+            nodes[newParent].parent = oldParent;
+            merge(nodes[newParent], nodes[sibling], nodes[leaf]);
+            nodes[newParent].height = std::max(nodes[sibling].height, nodes[leaf].height) + 1; // leaf may be a grafted subtree
+            nodes[newParent].left = sibling;
+            nodes[newParent].right = leaf;
+            nodes[sibling].parent = newParent;
+            nodes[leaf].parent = newParent;
+
+            if (oldParent == TREE2D_NULL_NODE) {
+                root = newParent;
+            } else if (nodes[oldParent].left == sibling) {
+                nodes[oldParent].left = newParent;
+            } else {
+                nodes[oldParent].right = newParent;
+            }
+
+            refitAncestors(nodes[leaf].parent);
+        }
+
+        void removeLeaf(int32_t leaf) {
+            if (leaf == root) {
+                root = TREE2D_NULL_NODE;
+                return;
+            }
+
+            int32_t parent = nodes[leaf].parent;
+            int32_t grandParent = nodes[parent].parent;
+            int32_t sibling = (nodes[parent].left == leaf) ? nodes[parent].right : nodes[parent].left;
+
+            if (grandParent == TREE2D_NULL_NODE) {
+                root = sibling;
+                nodes[sibling].parent = TREE2D_NULL_NODE;
+                freeNode(parent);
+                return;
+            }
+
+            if (nodes[grandParent].left == parent) nodes[grandParent].left = sibling;
+            else nodes[grandParent].right = sibling;
+            nodes[sibling].parent = grandParent;
+            freeNode(parent);
+
+            refitAncestors(grandParent);
+        }
+
+        void refitAncestors(int32_t index) {
+            while (index != TREE2D_NULL_NODE) {
+                index = balance(index);
+                refit(index);
+                index = nodes[index].parent;
+            }
+        }
+
+        // Performs a left or right rotation if node A is imbalanced and returns the new root of the subtree
+        int32_t balance(int32_t iA) {
+            Node &A = nodes[iA];
+            if (A.height < 2) return iA;
+
+            int32_t iB = A.left;
+            int32_t iC = A.right;
+            int32_t balanceFactor = nodes[iC].height - nodes[iB].height;
+
+            if (balanceFactor > 1) return rotate(iA, iC, false);
+            if (balanceFactor < -1) return rotate(iA, iB, true);
+            return iA;
+        }
+
+        // Promotes the higher child iUp of iA and returns it
+        int32_t rotate(int32_t iA, int32_t iUp, bool upIsLeft) {
+            Node &A = nodes[iA];
+            Node &Up = nodes[iUp];
+            int32_t iF = Up.left;
+            int32_t iG = Up.right;
+
+            // Swap A and Up
+            Up.left = iA;
+            Up.parent = A.parent;
+            A.parent = iUp;
+
+            if (Up.parent == TREE2D_NULL_NODE) {
+                root = iUp;
+            } else if (nodes[Up.parent].left == iA) {
+                nodes[Up.parent].left = iUp;
+            } else {
+                nodes[Up.parent].right = iUp;
+            }
+
+            // Keep the higher grandchild under Up and give the other one to A
+            int32_t iKeep = (nodes[iF].height > nodes[iG].height) ? iF : iG;
+            int32_t iMove = (iKeep == iF) ? iG : iF;
+            Up.right = iKeep;
+            if (upIsLeft) A.left = iMove;
+            else A.right = iMove;
+            nodes[iMove].parent = iA;
+
+            refit(iA);
+            refit(iUp);
+            return iUp;
+        }
+    };
+
+    // Broad phase adapter over Tree2D, the handles are the tree leaves
+    template <class T>
+    class Tree2DBroadphase : public Broadphase<T> {
+    public:
+        Tree2DBroadphase(float margin = 2) : tree(margin) {}
+
+        BroadphaseHandle insert(T object, const Bounds2 &bounds) override {
+            return tree.insert(object, bounds);
+        }
+
+        void remove(BroadphaseHandle handle) override {
+            tree.remove(handle);
+        }
+
+        void update(BroadphaseHandle handle, const Bounds2 &bounds) override {
+            tree.update(handle, bounds);
+        }
+
+        void insertBatch(const T *objects, const Bounds2 *bounds, uint32_t count, BroadphaseHandle *handles) override {
+            tree.insertBatch(objects, bounds, count, handles);
+        }
+
+        void removeBatch(const BroadphaseHandle *handles, uint32_t count) override {
+            tree.removeBatch(handles, count);
+        }
+
+        bool queryCallback(const Bounds2 &bounds, bool (*visitor)(T, void*), void *userData) override {
+            return tree.queryVisit(bounds, [visitor, userData](T object) { return visitor(object, userData); });
+        }
+
+        uint32_t size() override {
+            return tree.size();
+        }
+
+        void clear() override {
+            tree.clear();
+        }
+
+        const Tree2D<T> &getTree() const {
+            return tree;
+        }
+
+    private:
+        Tree2D<T> tree;
+    };
+
+}
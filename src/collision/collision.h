@@ -1,2 +1,3 @@
 #include <collision/structures/vec2.hpp>
 #include <collision/algorithm/CollisionDetector.h>
+#include <collision/algorithm/ContactCache.h>
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <collision/structures/vec2.hpp>
+
+namespace collision
+{
+// Axis aligned box, trivially copyable. Same layout as the corners of Rectangle: x1 left, y1 top, x2 right, y2 bottom
+// (y grows upwards). Every collision area is axis aligned, Rectangle is only kept for non rectangular shapes.
+struct Box2
+{
+    float x1, y1, x2, y2;
+
+    // Bounding box of a list of points
+    static Box2 fromPoints(const vec2<float> *points, size_t count)
+    {
+        Box2 box = { 99999.0f, 0.0f, 0.0f, 99999.0f };
+        for (size_t i = 0; i < count; i++) {
+            if (points[i].x < box.x1) { box.x1 = points[i].x; }
+            if (points[i].x > box.x2) { box.x2 = points[i].x; }
+            if (points[i].y > box.y1) { box.y1 = points[i].y; }
+            if (points[i].y < box.y2) { box.y2 = points[i].y; }
+        }
+        return box;
+    }
+
+    Box2 translated(float x, float y) const
+    {
+        return { x1 + x, y1 + y, x2 + x, y2 + y };
+    }
+
+    // Smallest box containing both boxes
+    Box2 merged(const Box2 &other) const
+    {
+        return { x1 < other.x1 ? x1 : other.x1, y1 > other.y1 ? y1 : other.y1,
+                 x2 > other.x2 ? x2 : other.x2, y2 < other.y2 ? y2 : other.y2 };
+    }
+
+    // Other lies inside this box, edges included
+    bool contains(const Box2 &other) const
+    {
+        return (other.x1 >= x1) && (other.x2 <= x2) && (other.y1 <= y1) && (other.y2 >= y2);
+    }
+
+    // Strict overlap, touching boxes don't collide
+    bool overlaps(const Box2 &other) const
+    {
+        return (x1 < other.x2) && (x2 > other.x1) && (y1 > other.y2) && (y2 < other.y1);
+    }
+};
+
+static_assert(std::is_trivially_copyable<Box2>::value, "Box2 must stay trivially copyable");
+
+} // namespace collision
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <collision/geometry/Box2.h>
+
+namespace collision
+{
+// Lanes of the widest batch test (AVX2, 8 floats). The arrays are always padded to a multiple of it.
+const size_t BOX_BATCH_WIDTH = 8;
+
+// Coordinate of the padding boxes: x1 and y2 at +BOX_BATCH_EMPTY, x2 and y1 at -BOX_BATCH_EMPTY
+const float BOX_BATCH_EMPTY = 1.0e9f;
+
+// Boxes packed as a structure of arrays so the narrow phase can test several of them with one instruction. Padding
+// slots hold an empty box that never overlaps anything. Coordinates stay well inside the int32 range so the batch
+// test can truncate them like the single pair test.
+struct BoxBatch
+{
+    std::vector<float> x1, y1, x2, y2;
+    size_t count = 0;
+
+    // Keeps the capacity, so refilling the batch every frame doesn't allocate
+    void clear()
+    {
+        x1.clear();
+        y1.clear();
+        x2.clear();
+        y2.clear();
+        count = 0;
+    }
+
+    void push(const Box2 &box)
+    {
+        if (count == x1.size()) {
+            x1.insert(x1.end(), BOX_BATCH_WIDTH, BOX_BATCH_EMPTY);
+            y1.insert(y1.end(), BOX_BATCH_WIDTH, -BOX_BATCH_EMPTY);
+            x2.insert(x2.end(), BOX_BATCH_WIDTH, -BOX_BATCH_EMPTY);
+            y2.insert(y2.end(), BOX_BATCH_WIDTH, BOX_BATCH_EMPTY);
+        }
+        x1[count] = box.x1;
+        y1[count] = box.y1;
+        x2[count] = box.x2;
+        y2[count] = box.y2;
+        count++;
+    }
+
+    // Keeps the first n boxes (n <= count) and turns the rest into padding
+    void truncate(size_t n)
+    {
+        for (size_t i = n; i < count; i++) {
+            x1[i] = BOX_BATCH_EMPTY;
+            y1[i] = -BOX_BATCH_EMPTY;
+            x2[i] = -BOX_BATCH_EMPTY;
+            y2[i] = BOX_BATCH_EMPTY;
+        }
+        count = n;
+    }
+
+    // Number of slots including the padding, a multiple of BOX_BATCH_WIDTH
+    size_t paddedCount() const
+    {
+        return x1.size();
+    }
+};
+
+} // namespace collision
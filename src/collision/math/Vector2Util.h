@@ -2,6 +2,7 @@
 
 #include <collision/structures/vec2.hpp>
 #include <cmath>
+#include <limits>
 
 using namespace std;
 
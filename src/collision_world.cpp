@@ -0,0 +1,266 @@
+#include "collision_world.h"
+#include "scene_object.h"
+#include <collision/broadphase/SpatialHashGrid.h>
+#include <collision/broadphase/Tree2D.h>
+#include <collision/broadphase/SweepAndPrune.h>
+#include <cmath>
+
+CollisionWorld::CollisionWorld(uint16_t cellWidth, uint16_t cellHeight, uint16_t columns, uint32_t maxRows) :
+  cellWidth(cellWidth),
+  cellHeight(cellHeight) {
+  terrainBroadphase = new collision::SpatialHashGrid<ISceneObject*>(cellWidth, cellHeight);
+#if defined(MOBILE_BROADPHASE_SWEEP_AND_PRUNE)
+  mobileBroadphase = new collision::SweepAndPrune<ISceneObject*>();
+#else
+  mobileBroadphase = new collision::Tree2DBroadphase<ISceneObject*>();
+#endif
+  tileLayer = new collision::TileLayer<ISceneObject*>(cellWidth, cellHeight, columns, maxRows);
+}
+
+CollisionWorld::~CollisionWorld() {
+  delete terrainBroadphase;
+  delete mobileBroadphase;
+  delete tileLayer;
+}
+
+collision::Broadphase<ISceneObject*>* CollisionWorld::BroadphaseForLayer(uint8_t layer) {
+  return (layer == COLLISION_LAYER_TERRAIN) ? terrainBroadphase : mobileBroadphase;
+}
+
+uint8_t CollisionWorld::LayerForObject(ISceneObject *objectPtr) {
+  if (objectPtr->Type() != SceneObjectType::TERRAIN) return COLLISION_LAYER_MOBILE;
+  int32_t row, column;
+  collision::Bounds2 bounds;
+  collision::Box2 box;
+  return TileOf(objectPtr, row, column, bounds, box) ? COLLISION_LAYER_TILES : COLLISION_LAYER_TERRAIN;
+}
+
+// Cell of a terrain object that can be stored as a tile: a single solid area inside one cell of the map. Its bounds
+// may spill one pixel out of the cell because they are truncated to integers.
+bool CollisionWorld::TileOf(ISceneObject *objectPtr, int32_t &row, int32_t &column, collision::Bounds2 &bounds, collision::Box2 &box) {
+  std::vector<Area> &solidAreas = objectPtr->GetSolidAreas();
+  if (solidAreas.size() != 1) return false;
+
+  box = solidAreas[0].box.translated(0.0f, scrollOffset);
+  if (!tileLayer->cellAt((box.x1 + box.x2) * 0.5f, (box.y1 + box.y2) * 0.5f, row, column)) return false;
+  float cellX1 = column * cellWidth, cellY1 = row * cellHeight;
+  float cellX2 = cellX1 + cellWidth, cellY2 = cellY1 + cellHeight;
+  if ((box.x1 < cellX1) || (box.x2 > cellX2) || (box.y2 < cellY1) || (box.y1 > cellY2)) return false;
+
+  bounds = BoundsOf(objectPtr);
+  return (bounds.lowerX >= cellX1 - 1.0f) && (bounds.upperX <= cellX2 + 1.0f) && (bounds.lowerY >= cellY1 - 1.0f) && (bounds.upperY <= cellY2 + 1.0f);
+}
+
+void CollisionWorld::AddTile(ISceneObject *objectPtr) {
+  int32_t row, column;
+  collision::Bounds2 bounds;
+  collision::Box2 box;
+  TileOf(objectPtr, row, column, bounds, box);
+  objectPtr->broadphaseHandle = tileLayer->setTile(row, column, objectPtr, bounds, box);
+  objectPtr->collisionLayer = COLLISION_LAYER_TILES;
+}
+
+collision::Bounds2 CollisionWorld::ToLevelBounds(const collision::Bounds2 &bounds) {
+  // One extra pixel covers the truncation of the screen positions to integers
+  return { bounds.lowerX, bounds.lowerY + scrollOffset - 1.0f, bounds.upperX, bounds.upperY + scrollOffset + 1.0f };
+}
+
+// Bounds of the object in the coordinates of its broad phase
+collision::Bounds2 CollisionWorld::BoundsOf(ISceneObject *objectPtr) {
+  collision::Bounds2 bounds = objectPtr->GetBounds();
+  if (objectPtr->Type() == SceneObjectType::TERRAIN) {
+    bounds.lowerY += scrollOffset;
+    bounds.upperY += scrollOffset;
+  }
+  return bounds;
+}
+
+void CollisionWorld::AddObject(ISceneObject *objectPtr) {
+  uint8_t layer = LayerForObject(objectPtr);
+  if (layer != COLLISION_LAYER_MOBILE) staticRevision++;
+  if (layer == COLLISION_LAYER_TILES) {
+    AddTile(objectPtr);
+    return;
+  }
+  objectPtr->broadphaseHandle = BroadphaseForLayer(layer)->insert(objectPtr, BoundsOf(objectPtr));
+  objectPtr->collisionLayer = layer;
+}
+
+void CollisionWorld::RemoveObject(ISceneObject *objectPtr) {
+  if (objectPtr->broadphaseHandle == collision::NULL_BROADPHASE_HANDLE) return;
+  if (objectPtr->collisionLayer != COLLISION_LAYER_MOBILE) staticRevision++;
+  if (objectPtr->collisionLayer == COLLISION_LAYER_TILES) tileLayer->clearTile(objectPtr->broadphaseHandle);
+  else BroadphaseForLayer(objectPtr->collisionLayer)->remove(objectPtr->broadphaseHandle);
+  objectPtr->broadphaseHandle = collision::NULL_BROADPHASE_HANDLE;
+}
+
+void CollisionWorld::UpdateObject(ISceneObject *objectPtr) {
+  if (objectPtr->broadphaseHandle == collision::NULL_BROADPHASE_HANDLE) return;
+
+  // Terrain that changed its sprite (a broken brick) may leave the tile layer or move to another cell
+  if ((objectPtr->collisionLayer == COLLISION_LAYER_TILES) || (LayerForObject(objectPtr) != objectPtr->collisionLayer)) {
+    RemoveObject(objectPtr);
+    AddObject(objectPtr);
+    return;
+  }
+  if (objectPtr->collisionLayer != COLLISION_LAYER_MOBILE) staticRevision++;
+  BroadphaseForLayer(objectPtr->collisionLayer)->update(objectPtr->broadphaseHandle, BoundsOf(objectPtr));
+}
+
+// The screen moved up by pixelDisplacement: only the mobile objects need their bounds updated
+void CollisionWorld::Scroll(float pixelDisplacement) {
+  scrollOffset += pixelDisplacement;
+  staticRevision++;
+}
+
+// Inserts a whole batch of objects (rows of the map) with the bulk build of each broad phase
+void CollisionWorld::AddObjects(const std::vector<ISceneObject*> &objects) {
+  staticRevision++;
+  batchLayers.clear();
+  for (ISceneObject *objectPtr : objects) {
+    uint8_t layer = LayerForObject(objectPtr);
+    if (layer == COLLISION_LAYER_TILES) AddTile(objectPtr);
+    batchLayers.push_back(layer);
+  }
+  AddBatch(objects, COLLISION_LAYER_TERRAIN);
+  AddBatch(objects, COLLISION_LAYER_MOBILE);
+}
+
+void CollisionWorld::AddBatch(const std::vector<ISceneObject*> &objects, uint8_t layer) {
+  batchObjects.clear();
+  batchBounds.clear();
+  for (size_t i = 0; i < objects.size(); i++) {
+    if (batchLayers[i] != layer) continue;
+    batchObjects.push_back(objects[i]);
+    batchBounds.push_back(BoundsOf(objects[i]));
+  }
+  if (batchObjects.empty()) return;
+
+  batchHandles.resize(batchObjects.size());
+  BroadphaseForLayer(layer)->insertBatch(batchObjects.data(), batchBounds.data(), batchObjects.size(), batchHandles.data());
+  for (size_t i = 0; i < batchObjects.size(); i++) {
+    batchObjects[i]->broadphaseHandle = batchHandles[i];
+    batchObjects[i]->collisionLayer = layer;
+  }
+}
+
+void CollisionWorld::RemoveObjects(const std::vector<ISceneObject*> &objects) {
+  staticRevision++;
+  for (ISceneObject *objectPtr : objects) {
+    if (objectPtr->collisionLayer == COLLISION_LAYER_TILES) RemoveObject(objectPtr);
+  }
+  RemoveBatch(objects, COLLISION_LAYER_TERRAIN);
+  RemoveBatch(objects, COLLISION_LAYER_MOBILE);
+}
+
+void CollisionWorld::RemoveBatch(const std::vector<ISceneObject*> &objects, uint8_t layer) {
+  batchHandles.clear();
+  for (ISceneObject *objectPtr : objects) {
+    if (objectPtr->collisionLayer != layer) continue;
+    if (objectPtr->broadphaseHandle == collision::NULL_BROADPHASE_HANDLE) continue;
+    batchHandles.push_back(objectPtr->broadphaseHandle);
+    objectPtr->broadphaseHandle = collision::NULL_BROADPHASE_HANDLE;
+  }
+  if (!batchHandles.empty()) BroadphaseForLayer(layer)->removeBatch(batchHandles.data(), batchHandles.size());
+}
+
+void CollisionWorld::DispatchTriggers(ISceneObject *sensor) {
+  if (sensor->TriggerMask() == 0) return;
+
+  for (auto &trigger : sensor->GetSimpleAreas()) {
+    if (trigger.mask == 0) continue;
+
+    // Tiles hold a single solid area
+    if (trigger.mask & COLLISION_CATEGORY_SOLID) {
+      VisitTiles(trigger.box, [sensor, &trigger](ISceneObject *tileObject, const collision::Box2&) {
+        Area &tileArea = tileObject->GetSolidAreas()[0];
+        sensor->OnTrigger(trigger, tileObject, tileArea);
+        tileObject->OnTrigger(tileArea, sensor, trigger);
+        return true;
+      });
+    }
+
+    VisitCandidates({ trigger.box.x1, trigger.box.y2, trigger.box.x2, trigger.box.y1 }, [sensor, &trigger](ISceneObject *candidate) {
+      if ((candidate == sensor) || ((candidate->CollisionCategories() & trigger.mask) == 0)) return true;
+      for (std::vector<Area> *areas : { &candidate->GetSolidAreas(), &candidate->GetSimpleAreas() }) {
+        for (auto &area : *areas) {
+          if (((area.category & trigger.mask) == 0) || !area.box.overlaps(trigger.box)) continue;
+          sensor->OnTrigger(trigger, candidate, area);
+          candidate->OnTrigger(area, sensor, trigger);
+        }
+      }
+      return true;
+    }, COLLISION_LAYER_TERRAIN | COLLISION_LAYER_MOBILE);
+  }
+}
+
+void CollisionWorld::QueryCandidates(const collision::Bounds2 &bounds, std::vector<ISceneObject*> &candidates, uint8_t layerMask) {
+  VisitCandidates(bounds, [&candidates](ISceneObject *candidate) { candidates.push_back(candidate); return true; }, layerMask);
+}
+
+void CollisionWorld::QueryCandidates(ISceneObject *objectPtr, std::vector<ISceneObject*> &candidates, uint8_t layerMask) {
+  // Collision candidates of an object, excluding the object itself
+  VisitCandidates(objectPtr->GetBounds(), [objectPtr, &candidates](ISceneObject *candidate) {
+    if (candidate != objectPtr) candidates.push_back(candidate);
+    return true;
+  }, layerMask);
+}
+
+// Sweeps the moving box against the solid areas of the grid terrain and the mobile objects around the displacement
+void CollisionWorld::SweepCandidates(const collision::Box2 &moving, float displacementX, float displacementY,
+                                     CollisionQueryHit &hit, uint8_t layerMask, ISceneObject *ignored) {
+  collision::Box2 swept = moving.merged(moving.translated(displacementX, displacementY));
+  VisitCandidates({ swept.x1, swept.y2, swept.x2, swept.y1 }, [&](ISceneObject *candidate) {
+    if (candidate == ignored) return true;
+    for (auto &solidArea : candidate->GetSolidAreas()) {
+      if (collisionDetector.sweepBox(moving, displacementX, displacementY, solidArea.box, hit.result)) {
+        hit.object = candidate;
+        hit.box = solidArea.box;
+      }
+    }
+    return true;
+  }, layerMask & (COLLISION_LAYER_TERRAIN | COLLISION_LAYER_MOBILE));
+}
+
+bool CollisionWorld::Raycast(const collision::vec2<float> &origin, const collision::vec2<float> &direction, float maxDistance,
+                             CollisionQueryHit &hit, uint8_t layerMask, ISceneObject *ignored) {
+  hit = CollisionQueryHit();
+  float length = std::sqrt(direction.x * direction.x + direction.y * direction.y);
+  if ((length == 0.0f) || (maxDistance <= 0.0f)) return false;
+  float displacementX = direction.x * maxDistance / length;
+  float displacementY = direction.y * maxDistance / length;
+
+  // The ray is swept as an empty box. Tiles are walked cell by cell in level coordinates, the first hit is the nearest.
+  if (layerMask & COLLISION_LAYER_TILES) {
+    collision::Box2 point = { origin.x, origin.y + scrollOffset, origin.x, origin.y + scrollOffset };
+    tileLayer->visitRay(point.x1, point.y1, displacementX, displacementY, [&](ISceneObject *tileObject, const collision::Box2 &tileBox) {
+      if ((tileObject == ignored) || !collisionDetector.sweepBox(point, displacementX, displacementY, tileBox, hit.result)) return true;
+      hit.object = tileObject;
+      hit.box = tileBox.translated(0.0f, -scrollOffset);
+      return false;
+    });
+  }
+  SweepCandidates({ origin.x, origin.y, origin.x, origin.y }, displacementX, displacementY, hit, layerMask, ignored);
+  return hit.result.hit;
+}
+
+bool CollisionWorld::SweepBox(const collision::Box2 &box, const collision::vec2<float> &displacement, CollisionQueryHit &hit,
+                              uint8_t layerMask, ISceneObject *ignored) {
+  hit = CollisionQueryHit();
+  if ((displacement.x == 0.0f) && (displacement.y == 0.0f)) return false;
+
+  // Tiles in the area covered by the whole displacement, in level coordinates
+  if (layerMask & COLLISION_LAYER_TILES) {
+    collision::Box2 moving = box.translated(0.0f, scrollOffset);
+    collision::Box2 swept = moving.merged(moving.translated(displacement.x, displacement.y));
+    tileLayer->visitTiles(swept, [&](ISceneObject *tileObject, const collision::Box2 &tileBox) {
+      if ((tileObject != ignored) && collisionDetector.sweepBox(moving, displacement.x, displacement.y, tileBox, hit.result)) {
+        hit.object = tileObject;
+        hit.box = tileBox.translated(0.0f, -scrollOffset);
+      }
+      return true;
+    });
+  }
+  SweepCandidates(box, displacement.x, displacement.y, hit, layerMask, ignored);
+  return hit.result.hit;
+}
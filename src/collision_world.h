@@ -0,0 +1,105 @@
+#ifndef COLLISION_WORLD_H
+#define COLLISION_WORLD_H
+
+#include <vector>
+#include <defines.h>
+#include <collision/broadphase/Broadphase.h>
+#include <collision/broadphase/TileLayer.h>
+#include <collision/algorithm/CollisionDetector.h>
+#include <collision/algorithm/SweepResult.h>
+
+class ISceneObject;
+
+// Layers of the broad phase, queries only search the layers of their mask
+enum CollisionLayer: uint8_t { COLLISION_LAYER_TERRAIN = 0x01, COLLISION_LAYER_MOBILE = 0x02, COLLISION_LAYER_TILES = 0x04, COLLISION_LAYER_ALL = 0x07 };
+
+// First object hit by a ray or a swept box: its solid box and, in result, the fraction of the displacement travelled
+// before touching it and the normal of the touched face
+struct CollisionQueryHit { ISceneObject *object = nullptr; collision::Box2 box; collision::SweepResult result; };
+
+// Broad phase of the scene objects. Each object class is stored in the structure that suits it best: terrain that
+// fits a cell of the world map with a single solid area (bricks) goes to a tile layer, a bitset of solid cells per
+// row with their solid boxes, the rest of the terrain to a static uniform grid and mobile objects (player and enemies)
+// to a 2D dynamic AABB tree with fattened bounds (or, built with MOBILE_BROADPHASE_SWEEP_AND_PRUNE, to a sort and
+// sweep on the Y axis, cheaper to update once there are many of them).
+// Terrain is stored in level coordinates (screen coordinates plus the scrolled height), so the vertical scroll never
+// touches it: the tiles and the grid are only patched when rows stream in or out or a terrain object changes.
+class CollisionWorld
+{
+  collision::Broadphase<ISceneObject*> *terrainBroadphase = nullptr;
+  collision::Broadphase<ISceneObject*> *mobileBroadphase = nullptr;
+  collision::TileLayer<ISceneObject*> *tileLayer = nullptr;
+  collision::Broadphase<ISceneObject*>* BroadphaseForLayer(uint8_t);
+  uint8_t LayerForObject(ISceneObject*);
+  bool TileOf(ISceneObject*, int32_t &row, int32_t &column, collision::Bounds2&, collision::Box2&);
+  void AddTile(ISceneObject*);
+  float scrollOffset = 0.0f;
+  uint32_t staticRevision = 0;
+  float cellWidth, cellHeight;
+  collision::Bounds2 BoundsOf(ISceneObject*);
+  collision::Bounds2 ToLevelBounds(const collision::Bounds2&);
+
+  // Scratch of the batch operations, reused between rows
+  std::vector<ISceneObject*> batchObjects;
+  std::vector<collision::Bounds2> batchBounds;
+  std::vector<collision::BroadphaseHandle> batchHandles;
+  std::vector<uint8_t> batchLayers;
+  void AddBatch(const std::vector<ISceneObject*>&, uint8_t layer);
+  void RemoveBatch(const std::vector<ISceneObject*>&, uint8_t layer);
+
+  collision::CollisionDetector collisionDetector;
+  void SweepCandidates(const collision::Box2 &moving, float displacementX, float displacementY, CollisionQueryHit&,
+                       uint8_t layerMask, ISceneObject *ignored);
+public:
+  // columns and maxRows are the size of the part of the world map alive at once
+  CollisionWorld(uint16_t cellWidth, uint16_t cellHeight, uint16_t columns, uint32_t maxRows);
+  ~CollisionWorld();
+  void AddObject(ISceneObject*);
+  void RemoveObject(ISceneObject*);
+  void UpdateObject(ISceneObject*);
+  void AddObjects(const std::vector<ISceneObject*>&);
+  void RemoveObjects(const std::vector<ISceneObject*>&);
+  void Scroll(float pixelDisplacement);
+
+  // Trigger pass of an object: calls OnTrigger on it and on every other object with an area overlapping one of its
+  // trigger areas (simple areas with a mask) and a category in the mask. Objects without trigger areas cost nothing,
+  // candidates whose categories are out of the mask are rejected before touching their areas.
+  void DispatchTriggers(ISceneObject*);
+
+  // Changes whenever the terrain or its screen coordinates change, so terrain gathered earlier can be reused while it
+  // stays the same
+  uint32_t StaticRevision() const { return staticRevision; }
+  void QueryCandidates(const collision::Bounds2&, std::vector<ISceneObject*>&, uint8_t layerMask = COLLISION_LAYER_ALL);
+  void QueryCandidates(ISceneObject*, std::vector<ISceneObject*>&, uint8_t layerMask = COLLISION_LAYER_ALL);
+
+  // First solid area hit by the segment from origin along direction up to maxDistance, fraction of maxDistance in
+  // hit.result.time. Screen coordinates, no allocation. Touching an edge is not a hit, like the narrow phase.
+  bool Raycast(const collision::vec2<float> &origin, const collision::vec2<float> &direction, float maxDistance,
+               CollisionQueryHit &hit, uint8_t layerMask = COLLISION_LAYER_ALL, ISceneObject *ignored = nullptr);
+
+  // First solid area hit by the box moving along displacement. Boxes already overlapping at the start are not hits.
+  bool SweepBox(const collision::Box2 &box, const collision::vec2<float> &displacement, CollisionQueryHit &hit,
+                uint8_t layerMask = COLLISION_LAYER_ALL, ISceneObject *ignored = nullptr);
+
+  // Calls fn for every collision candidate of the layers in layerMask until it returns false, without allocating.
+  // Bounds are in screen coordinates.
+  template <class Fn>
+  bool VisitCandidates(const collision::Bounds2 &bounds, Fn &&fn, uint8_t layerMask = COLLISION_LAYER_ALL) {
+    if ((layerMask & COLLISION_LAYER_TILES) && !tileLayer->queryVisit(ToLevelBounds(bounds), fn)) return false;
+    if ((layerMask & COLLISION_LAYER_TERRAIN) && !terrainBroadphase->queryVisit(ToLevelBounds(bounds), fn)) return false;
+    if ((layerMask & COLLISION_LAYER_MOBILE) && !mobileBroadphase->queryVisit(bounds, fn)) return false;
+    return true;
+  }
+
+  // Calls fn(object, solid box) for every solid tile overlapping the box until fn returns false. Reads the boxes
+  // straight from the tile layer without touching the objects. Boxes are in screen coordinates.
+  template <class Fn>
+  bool VisitTiles(const collision::Box2 &box, Fn &&fn) {
+    float offset = scrollOffset;
+    return tileLayer->visitTiles(box.translated(0.0f, offset), [offset, &fn](ISceneObject *objectPtr, const collision::Box2 &tileBox) {
+      return fn(objectPtr, tileBox.translated(0.0f, -offset));
+    });
+  }
+};
+
+#endif
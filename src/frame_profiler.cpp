@@ -0,0 +1,81 @@
+#include "frame_profiler.h"
+#include <cstdio>
+
+FrameProfiler::FrameProfiler() {
+}
+
+FrameProfiler::~FrameProfiler() {
+}
+
+void FrameProfiler::CreateGpuQueries() {
+  // Needs a current OpenGL context
+  for(uint8_t slot=0; slot<GPU_QUERY_RING_SIZE; slot++) {
+    glGenQueries(GPU_STAGES, gpuQueries[slot]);
+  }
+  gpuQueriesCreated = true;
+}
+
+void FrameProfiler::DeleteGpuQueries() {
+  if(!gpuQueriesCreated) return;
+
+  for(uint8_t slot=0; slot<GPU_QUERY_RING_SIZE; slot++) {
+    glDeleteQueries(GPU_STAGES, gpuQueries[slot]);
+  }
+  gpuQueriesCreated = false;
+}
+
+void FrameProfiler::BeginCpuStage() {
+  cpuStageStart = std::chrono::high_resolution_clock::now();
+}
+
+void FrameProfiler::EndCpuStage(ProfilerCpuStage stage) {
+  std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - cpuStageStart;
+  std::lock_guard<std::mutex> lock(cpuTimesMutex);
+  cpuTimes[stage] = elapsed.count();
+}
+
+void FrameProfiler::BeginGpuStage(ProfilerGpuStage stage) {
+  if(!gpuQueriesCreated) return;
+
+  glBeginQuery(GL_TIME_ELAPSED, gpuQueries[currentQuerySlot][stage]);
+  gpuQueriesIssued[currentQuerySlot][stage] = true;
+}
+
+void FrameProfiler::EndGpuStage() {
+  if(!gpuQueriesCreated) return;
+
+  glEndQuery(GL_TIME_ELAPSED);
+}
+
+void FrameProfiler::EndGpuFrame() {
+  if(!gpuQueriesCreated) return;
+
+  // Move to the oldest slot of the ring and collect its results before issuing new queries on it
+  currentQuerySlot = (currentQuerySlot + 1) % GPU_QUERY_RING_SIZE;
+  for(uint8_t stage=0; stage<GPU_STAGES; stage++) {
+    if(!gpuQueriesIssued[currentQuerySlot][stage]) continue;
+
+    int32_t available = 0;
+    glGetQueryObjectiv(gpuQueries[currentQuerySlot][stage], GL_QUERY_RESULT_AVAILABLE, &available);
+    if(available) {
+      uint64_t nanoseconds = 0;
+      glGetQueryObjectui64v(gpuQueries[currentQuerySlot][stage], GL_QUERY_RESULT, &nanoseconds);
+      gpuTimes[stage] = nanoseconds / 1000000.0f;
+    }
+  }
+}
+
+float FrameProfiler::GetCpuStageTime(ProfilerCpuStage stage) {
+  std::lock_guard<std::mutex> lock(cpuTimesMutex);
+  return cpuTimes[stage];
+}
+
+float FrameProfiler::GetGpuStageTime(ProfilerGpuStage stage) {
+  return gpuTimes[stage];
+}
+
+void FrameProfiler::Summary(char *text, size_t length) {
+  snprintf(text, length, "[GPU upload: %.3f ms | draw: %.3f ms] [CPU mobile: %.3f ms | static: %.3f ms | scroll: %.3f ms | emit: %.3f ms]",
+           GetGpuStageTime(GPU_UPLOAD), GetGpuStageTime(GPU_DRAW),
+           GetCpuStageTime(CPU_UPDATE_MOBILE), GetCpuStageTime(CPU_UPDATE_STATIC), GetCpuStageTime(CPU_SCROLL), GetCpuStageTime(CPU_EMIT));
+}
@@ -0,0 +1,42 @@
+#ifndef _FRAME_PROFILER_H
+#define _FRAME_PROFILER_H
+
+#include <mutex>
+#include <chrono>
+#include <defines.h>
+#include <glad/glad.h>
+
+#define GPU_QUERY_RING_SIZE 2 // Query results are read one frame later so the cpu never waits for the gpu
+
+// Stages of the game logic update (logic thread)
+enum ProfilerCpuStage: uint8_t { CPU_UPDATE_MOBILE = 0, CPU_UPDATE_STATIC = 1, CPU_SCROLL = 2, CPU_EMIT = 3, CPU_STAGES = 4 };
+
+// Stages of the frame rendering (render thread)
+enum ProfilerGpuStage: uint8_t { GPU_UPLOAD = 0, GPU_DRAW = 1, GPU_STAGES = 2 };
+
+class FrameProfiler {
+  std::mutex cpuTimesMutex;
+  float cpuTimes[CPU_STAGES] = { 0.0f }; // milliseconds
+  float gpuTimes[GPU_STAGES] = { 0.0f }; // milliseconds
+  uint32_t gpuQueries[GPU_QUERY_RING_SIZE][GPU_STAGES];
+  bool gpuQueriesIssued[GPU_QUERY_RING_SIZE][GPU_STAGES] = { { false } };
+  uint8_t currentQuerySlot = 0;
+  bool gpuQueriesCreated = false;
+  std::chrono::high_resolution_clock::time_point cpuStageStart;
+
+public:
+  FrameProfiler();
+  ~FrameProfiler();
+  void CreateGpuQueries();
+  void DeleteGpuQueries();
+  void BeginCpuStage();
+  void EndCpuStage(ProfilerCpuStage);
+  void BeginGpuStage(ProfilerGpuStage);
+  void EndGpuStage();
+  void EndGpuFrame();
+  float GetCpuStageTime(ProfilerCpuStage);
+  float GetGpuStageTime(ProfilerGpuStage);
+  void Summary(char*, size_t);
+};
+
+#endif
@@ -76,10 +76,16 @@ void Brick::LoadNextSprite()
   currentSprite.v1 = spriteData.v1;
   currentSprite.u2 = spriteData.u2;
   currentSprite.v2 = spriteData.v2;
+  currentSprite.paletteId = spriteData.paletteId;
+  currentSprite.atlasPage = spriteData.atlasPage;
+  SpriteAreas *previousAreas = currentSprite.areas;
   currentSprite.areas = spriteData.areas;
   recalculateAreasDataIsNeeded = true; // Is necessary because the current sprite may have different areas
   boundingBox = { spriteData.lowerBoundX, spriteData.lowerBoundY, spriteData.upperBoundX, spriteData.upperBoundY };
   firstSpriteOfCurrentAnimationIsLoaded = true;
+
+  // A brick that lost its solid area (it broke) leaves the tile layer of the collision world
+  if((collisionWorld != nullptr) && (previousAreas != currentSprite.areas)) collisionWorld->UpdateObject(this);
 }
 
 SpriteData Brick::NextSpriteData()
@@ -113,6 +119,14 @@ bool Brick::BeginAnimationLoopAgain()
         return false;
 }
 
+// The hammer of the main character hits the brick
+void Brick::OnTrigger(const Area &area, ISceneObject *other, const Area &otherArea)
+{
+        if(otherArea.category == COLLISION_CATEGORY_HAMMER) {
+                ReceiveHammerImpact();
+        }
+}
+
 void Brick::ReceiveHammerImpact()
 {
         cout << "Brick::ReceiveHammerImpact()" << endl;
@@ -125,11 +139,11 @@ void Brick::ReceiveHammerImpact()
 void Brick::STATE_Sticky()
 {
         cout << "Brick::STATE_Sticky" << endl;
-        LoadAnimationWithId(BrickAnimation::BRICK_GREEN_STICKY);
+        LoadAnimationWithId(stickyAnimationId);
 }
 
 void Brick::STATE_Falling()
 {
         cout << "Brick::STATE_Falling" << endl;
-        LoadAnimationWithId(BrickAnimation::BRICK_GREEN_FALLING);
+        LoadAnimationWithId(fallingAnimationId);
 }
@@ -24,6 +24,9 @@ class Brick: public ISceneObject
   void LoadNextSprite();
 protected:
   void LoadAnimationWithId(uint16_t);
+  // Animations of the states, each kind of brick has its own
+  uint16_t stickyAnimationId = BrickAnimation::BRICK_GREEN_STICKY;
+  uint16_t fallingAnimationId = BrickAnimation::BRICK_GREEN_FALLING;
 public:
   Brick(SceneObjectIdentificator, SceneObjectType, unsigned char);
   Brick();
@@ -35,6 +38,7 @@ class Brick: public ISceneObject
   bool Update(uint8_t);
   static ISceneObject* Create();
 
+  virtual void OnTrigger(const Area&, ISceneObject*, const Area&);
   void ReceiveHammerImpact();
   bool BeginAnimationLoopAgain();
 
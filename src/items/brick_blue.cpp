@@ -11,7 +11,9 @@ void BrickBlue::PrintName() {
 
 void BrickBlue::InitWithSpriteSheet(ObjectSpriteSheet *_spriteSheet) {
         spriteSheet = _spriteSheet;
-        LoadAnimationWithId(BrickBlueAnimation::BRICK_BLUE_STICKY);
+        stickyAnimationId = BrickBlueAnimation::BRICK_BLUE_STICKY;
+        fallingAnimationId = BrickBlueAnimation::BRICK_BLUE_FALLING;
+        LoadAnimationWithId(stickyAnimationId);
 }
 
 ISceneObject* BrickBlue::Create() {
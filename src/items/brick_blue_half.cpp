@@ -11,7 +11,9 @@ void BrickBlueHalf::PrintName() {
 
 void BrickBlueHalf::InitWithSpriteSheet(ObjectSpriteSheet *_spriteSheet) {
         spriteSheet = _spriteSheet;
-        LoadAnimationWithId(BrickBlueHalfAnimation::BRICK_BLUE_HALF_STICKY);
+        stickyAnimationId = BrickBlueHalfAnimation::BRICK_BLUE_HALF_STICKY;
+        fallingAnimationId = BrickBlueHalfAnimation::BRICK_BLUE_HALF_FALLING;
+        LoadAnimationWithId(stickyAnimationId);
 }
 
 ISceneObject* BrickBlueHalf::Create() {
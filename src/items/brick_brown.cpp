@@ -11,7 +11,9 @@ void BrickBrown::PrintName() {
 
 void BrickBrown::InitWithSpriteSheet(ObjectSpriteSheet *_spriteSheet) {
         spriteSheet = _spriteSheet;
-        LoadAnimationWithId(BrickBrownAnimation::BRICK_BROWN_STICKY);
+        stickyAnimationId = BrickBrownAnimation::BRICK_BROWN_STICKY;
+        fallingAnimationId = BrickBrownAnimation::BRICK_BROWN_FALLING;
+        LoadAnimationWithId(stickyAnimationId);
 }
 
 ISceneObject* BrickBrown::Create() {
@@ -11,7 +11,9 @@ void BrickBrownHalf::PrintName() {
 
 void BrickBrownHalf::InitWithSpriteSheet(ObjectSpriteSheet *_spriteSheet) {
         spriteSheet = _spriteSheet;
-        LoadAnimationWithId(BrickBrownHalfAnimation::BRICK_BROWN_HALF_STICKY);
+        stickyAnimationId = BrickBrownHalfAnimation::BRICK_BROWN_HALF_STICKY;
+        fallingAnimationId = BrickBrownHalfAnimation::BRICK_BROWN_HALF_FALLING;
+        LoadAnimationWithId(stickyAnimationId);
 }
 
 ISceneObject* BrickBrownHalf::Create() {
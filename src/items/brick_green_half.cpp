@@ -11,7 +11,9 @@ void BrickGreenHalf::PrintName() {
 
 void BrickGreenHalf::InitWithSpriteSheet(ObjectSpriteSheet *_spriteSheet) {
         spriteSheet = _spriteSheet;
-        LoadAnimationWithId(BrickGreenHalfAnimation::BRICK_GREEN_HALF_STICKY);
+        stickyAnimationId = BrickGreenHalfAnimation::BRICK_GREEN_HALF_STICKY;
+        fallingAnimationId = BrickGreenHalfAnimation::BRICK_GREEN_HALF_FALLING;
+        LoadAnimationWithId(stickyAnimationId);
 }
 
 ISceneObject* BrickGreenHalf::Create() {
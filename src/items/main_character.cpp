@@ -44,9 +44,6 @@ bool MainCharacter::Update(const uint8_t pressedKeys_) {
 
     }
 
-    // Check for collisions
-    UpdateCollisions();
-
     if (!animationLoaded) {
         return false;
     }
@@ -58,122 +55,21 @@ bool MainCharacter::Update(const uint8_t pressedKeys_) {
     if (chrono::system_clock::now() >= nextSpriteTime) {
         // Load next sprite of the current animation
         LoadNextSprite();
-
-        // Check for possible collisions with the solid areas of the currrent sprite
-        UpdateCollisions();
-
         return true;
     }
 
     return needRedraw;
 }
 
-// Search for collisions with solid objects
-void MainCharacter::GetSolidCollisions(std::vector<ObjectCollisionData> &collidingSolidObjects) {
-    if (currentSprite.areas == nullptr) return;
-
-    // Check for possible potential collision candidates objects
-    std::vector<ISceneObject *> potentialCollisionCandidatesObjects = spacePartitionObjectsTree->query(GetLowerBound(),GetUpperBound());
-
-    uint16_t potentialCollisionObjectsCount = potentialCollisionCandidatesObjects.size();
-    if (potentialCollisionObjectsCount) {
-
-        // Iterate all potential collision candidates and check for real collisions
-        for (uint16_t i = 0; i < potentialCollisionObjectsCount; i++) {
-            ISceneObject *collisionCandidateObject = potentialCollisionCandidatesObjects[i];
-            if (collisionCandidateObject != this) {
-
-                // Check precise collision of every solid area of the collision candidate object with every solid area of the main character
-                std::vector<Area> &collisionCandidateObjectSolidAreas = collisionCandidateObject->GetSolidAreas();
-                for (auto & collisionCandidateObjectSolidArea : collisionCandidateObjectSolidAreas) {
-                    collision::Rectangle candidateSolidAreaRectangle = collisionCandidateObjectSolidArea.rectangle;
-
-                    // Check collision with all main character solid areas
-                    std::vector<Area> &mainCharacterSolidAreas = GetSolidAreas();
-
-                    collision::Penetration penetration;
-                    for (auto & mainCharacterSolidArea : mainCharacterSolidAreas) {
-                        collision::Rectangle mainCharacterSolidAreaRectangle = mainCharacterSolidArea.rectangle;
-                        bool collision = collisionDetector.checkCollision(mainCharacterSolidAreaRectangle,
-                                                                          candidateSolidAreaRectangle, penetration,
-                                                                          PlayerIsQuiet() ? prevVectorDirection
-                                                                                          : vectorDirection);
-
-                        if (collision) {
-                            //mainCharacterSolidAreaRectangle.Print();
-                            //candidateSolidAreaRectangle.Print();
-                            collidingSolidObjects.push_back({collisionCandidateObject, penetration.depth.x, penetration.depth.y,&vectorDirection});
-                        }
-                    }
-                }
-            }
-        }
-    }
-}
-
-void MainCharacter::MoveToPositionOfNoCollision(std::vector<ObjectCollisionData> &collidingSolidObjectsData) {
-    if (currentSprite.areas == nullptr) return;
-
-    std::vector<collision::Rectangle> targetRectangles;
-    for(auto & solidObjectData : collidingSolidObjectsData) {
-        for (auto & solidArea : solidObjectData.object->GetSolidAreas()) {
-            targetRectangles.push_back(solidArea.rectangle);
-        }
-    }
-
-    std::vector<collision::Rectangle> movingRectangles;
-    for (auto & solidArea : GetSolidAreas()) {
-        movingRectangles.push_back(solidArea.rectangle);
-    }
-
-    collisionDetector.updateWithNonCollidingPosition(targetRectangles, movingRectangles, position,
-                                                     PlayerIsQuiet() ? prevVectorDirection : vectorDirection);
-}
-
-void MainCharacter::UpdateCollisions() {
-    std::cout << "TRAJECTORY TANGENT: " << position.getTrajectoryTangent() << "\n";
-
-    std::vector<ObjectCollisionData> collidingSolidObjects;
-    // Search for collisions with solid objects
-    this->GetSolidCollisions(collidingSolidObjects);
-
-    // Process colliding objects according to the current scenario
-    uint16_t collidingSolidObjectsCount = collidingSolidObjects.size();
-    if (collidingSolidObjectsCount) {
-
-        if ((vectorDirection.x == 0) || (vectorDirection.y == 0)) {
-            std::cout << " >>>>>> VERTICAL or HORIZONTAL COLLISION\n";
-            // Collision when object displacement is vertical or horizontal. Non diagonal displacement.
-            int16_t maxHorizontalPenetrationDepth = 0;
-            int16_t maxVerticalPenetrationDepth = 0;
-
-            for (uint16_t i = 0; i < collidingSolidObjectsCount; i++) {
-                ObjectCollisionData objectCollisionData = collidingSolidObjects.at(i);
-                if (std::abs(objectCollisionData.penetration_y) > std::abs(maxVerticalPenetrationDepth)) {
-                    maxVerticalPenetrationDepth = objectCollisionData.penetration_y;
-                }
-
-                if (std::abs(objectCollisionData.penetration_x) > std::abs(maxHorizontalPenetrationDepth)) {
-                    maxHorizontalPenetrationDepth = objectCollisionData.penetration_x;
-                }
-            }
-
-            // Update the array of pillar objects (objects who are currently sustaining the main character from the bottom side)
-            pillarObjects.clear();
-            for (uint16_t i = 0; i < collidingSolidObjectsCount; i++) {
-                ObjectCollisionData objectCollisionData = collidingSolidObjects.at(i);
-                if (objectCollisionData.penetration_y == maxVerticalPenetrationDepth) {
-                    pillarObjects.push_back(objectCollisionData.object);
-                }
-            }
-
-            PositionAddX(int16_t(-maxHorizontalPenetrationDepth));
-            PositionAddY(int16_t(-maxVerticalPenetrationDepth));
-
+// Reaction to the resolution of the collisions by the kinematic body pass, once the main character has been moved
+// out of the solid objects
+void MainCharacter::OnCollisionsResolved(const KinematicBody &body) {
+    if (body.contactCount) {
+        if (!body.diagonal) {
             // Colliding during jump causes finish jump and fall
             if (isJumping) {
                 // Check if collision has been detected on top of the main character during jumping
-                if (maxVerticalPenetrationDepth > 0) {
+                if (body.penetration_y > 0) {
                     // Causes main character fall down
                     TopCollisionDuringJump();
                 } else {
@@ -184,16 +80,19 @@ void MainCharacter::UpdateCollisions() {
                 // If collision is produced during fall then finish the fall;
                 FinishFall();
             }
-
         } else {
-            std::cout << " >>>>>> DIAGONAL COLLISION\n";
-            // 
-            this->MoveToPositionOfNoCollision(collidingSolidObjects);
-
             if (isJumping) { FinishJump(); }
+            else if (isFalling) { FinishFall(); }
         }
+    }
 
-        //ProcessPressedKeys(false);
+    // Ground transitions: walking off a ledge (or losing the brick below) starts a fall. Landings are handled above,
+    // by the collision that places the main character on top of the ground.
+    if (body.groundEvent == collision::CONTACT_EVENT_AIRBORNE) {
+        isLeaningOnTheGround = false;
+        if (!isJumping && !isFalling) { LostGround(); }
+    } else if (body.groundEvent == collision::CONTACT_EVENT_GROUNDED) {
+        if (!isJumping && !isFalling) { isLeaningOnTheGround = true; }
     }
 }
 
@@ -322,6 +221,8 @@ void MainCharacter::LoadNextSprite() {
     currentSprite.v1 = spriteData.v1;
     currentSprite.u2 = spriteData.u2;
     currentSprite.v2 = spriteData.v2;
+    currentSprite.paletteId = spriteData.paletteId;
+    currentSprite.atlasPage = spriteData.atlasPage;
     currentSprite.areas = spriteData.areas;
 
     // Adjusts objectposition according to the sprite offset
@@ -594,6 +495,28 @@ void MainCharacter::DownKeyPressed() {
     END_TRANSITION_MAP(nullptr)
 }
 
+void MainCharacter::LostGround() {
+    cout << "MainCharacter::LostGround()" << endl;
+    BEGIN_TRANSITION_MAP                                  // - Current State -
+            TRANSITION_MAP_ENTRY (STATE_FALL_IDLE_RIGHT)          // STATE_Idle_Right
+            TRANSITION_MAP_ENTRY (STATE_FALL_IDLE_LEFT)                 // STATE_Idle_Left
+            TRANSITION_MAP_ENTRY (STATE_FALL_RUN_RIGHT)                  // STATE_Run_Right
+            TRANSITION_MAP_ENTRY (STATE_FALL_RUN_LEFT)                  // STATE_Run_Left
+            TRANSITION_MAP_ENTRY (EVENT_IGNORED)    // STATE_Jump_Idle_Right
+            TRANSITION_MAP_ENTRY (EVENT_IGNORED)    // STATE_Jump_Idle_Left
+            TRANSITION_MAP_ENTRY (EVENT_IGNORED)    // STATE_Jump_Run_Right
+            TRANSITION_MAP_ENTRY (EVENT_IGNORED)    // STATE_Jump_Run_Left
+            TRANSITION_MAP_ENTRY (EVENT_IGNORED)    // STATE_Fall_Idle_Right
+            TRANSITION_MAP_ENTRY (EVENT_IGNORED)    // STATE_Fall_Idle_Left
+            TRANSITION_MAP_ENTRY (EVENT_IGNORED)    // STATE_Fall_Run_Right
+            TRANSITION_MAP_ENTRY (EVENT_IGNORED)    // STATE_Fall_Run_Left
+            TRANSITION_MAP_ENTRY (EVENT_IGNORED)    // STATE_Fall_Jump_Run_Right
+            TRANSITION_MAP_ENTRY (EVENT_IGNORED)    // STATE_Fall_Jump_Run_Left
+            TRANSITION_MAP_ENTRY (EVENT_IGNORED)    // STATE_Hit_Right
+            TRANSITION_MAP_ENTRY (EVENT_IGNORED)    // STATE_Hit_Left
+    END_TRANSITION_MAP(nullptr)
+}
+
 void MainCharacter::TopCollisionDuringJump() {
     cout << "MainCharacter::TopCollisionDuringJump()" << endl;
     BEGIN_TRANSITION_MAP                                  // - Current State -
@@ -7,11 +7,11 @@
 #include <state_machine.h>
 #include <sprite.h>
 #include "collision/collision.h"
+#include <kinematic_body_system.h>
 
 using namespace std;
 
 enum MainCharacterDirection: uint8_t { RIGHT = 0, LEFT = 1 };
-struct ObjectCollisionData { ISceneObject* object; int16_t penetration_x; int16_t penetration_y; collision::vec2<int16_t> *vectorDirection; };
 
 class MainCharacter: public ISceneObject
 {
@@ -30,8 +30,6 @@ class MainCharacter: public ISceneObject
   void LoadNextSprite();
   bool PlayerIsQuiet();
   void UpdatePreviousDirection();
-  void GetSolidCollisions(std::vector<ObjectCollisionData>&);
-  void MoveToPositionOfNoCollision(std::vector<ObjectCollisionData>&);
 
   // Jump trajectory data
   float hInitialJumpSpeed = 0.0f;
@@ -52,10 +50,6 @@ class MainCharacter: public ISceneObject
   const float gravity = 9.81f;
   uint16_t hMomentum = 0;
   const uint16_t maxMomentum = 15;
-  collision::CollisionDetector collisionDetector;
-  collision::vec2<int16_t> vectorDirection;
-  collision::vec2<int16_t> prevVectorDirection;
-  std::vector<ISceneObject*> pillarObjects;
 
   // Player action states
   bool isJumping = false;
@@ -64,7 +58,6 @@ class MainCharacter: public ISceneObject
   bool isFalling = false;
 
   // Player action update functions
-  void UpdateCollisions();
   void MoveTo(MainCharacterDirection);
   void Jump(float vSpeed, float hSpeed);
   void UpdateJump();
@@ -80,6 +73,7 @@ class MainCharacter: public ISceneObject
   uint16_t Height() override;
   void PrintName() override;
   bool Update(uint8_t) override;
+  void OnCollisionsResolved(const KinematicBody&) override;
   static ISceneObject* Create();
 
   void RightKeyPressed();
@@ -92,6 +86,7 @@ class MainCharacter: public ISceneObject
   void JumpLanding();
   void FallLanding();
   void TopCollisionDuringJump();
+  void LostGround();
   bool ShouldBeginAnimationLoopAgain();
   //void ReachedSpeedForRunning();
 
@@ -73,6 +73,8 @@ void SideWall::LoadNextSprite()
   currentSprite.v1 = spriteData.v1;
   currentSprite.u2 = spriteData.u2;
   currentSprite.v2 = spriteData.v2;
+  currentSprite.paletteId = spriteData.paletteId;
+  currentSprite.atlasPage = spriteData.atlasPage;
   boundingBox = { spriteData.lowerBoundX, spriteData.lowerBoundY, spriteData.upperBoundX, spriteData.upperBoundY };
   firstSpriteOfCurrentAnimationIsLoaded = true;
 }
@@ -0,0 +1,119 @@
+#include "kinematic_body_system.h"
+#include <algorithm>
+#include <cstdlib>
+#include "scene_object.h"
+
+KinematicBodySystem::KinematicBodySystem(CollisionWorld *_collisionWorld) : collisionWorld(_collisionWorld) {
+}
+
+void KinematicBodySystem::AddBody(ISceneObject *objectPtr) {
+  auto it = std::lower_bound(bodies.begin(), bodies.end(), objectPtr->uniqueId, [](const KinematicBody &body, uint32_t uniqueId) {
+    return body.object->uniqueId < uniqueId;
+  });
+  KinematicBody body;
+  body.object = objectPtr;
+  bodies.insert(it, std::move(body));
+}
+
+void KinematicBodySystem::RemoveBody(ISceneObject *objectPtr) {
+  bodies.erase(std::remove_if(bodies.begin(), bodies.end(), [objectPtr](const KinematicBody &body) {
+    return body.object == objectPtr;
+  }), bodies.end());
+}
+
+// Appends the contacts of the body to the pair list. The terrain around the body is gathered again only when it
+// leaves the area gathered last time or the terrain changes: the solid tiles straight from the tile map, the rest of
+// the terrain from the broad phase. Mobile objects move on their own, they are searched every frame.
+void KinematicBodySystem::GatherPairs(KinematicBody &body) {
+  ISceneObject *objectPtr = body.object;
+  body.firstPair = pairs.size();
+  body.contactCount = 0;
+  body.groundEvent = collision::CONTACT_EVENT_NONE;
+
+  body.solidBoxes.clear();
+  for(auto & solidArea : objectPtr->GetSolidAreas()) body.solidBoxes.push_back(solidArea.box);
+  if(body.solidBoxes.empty()) return;
+
+  collision::ContactCache<ISceneObject*> &contactCache = body.contactCache;
+  if(contactCache.beginFrame(body.solidBoxes, collisionWorld->StaticRevision())) {
+    const collision::Box2 &fatBox = contactCache.fatBox();
+    collisionWorld->VisitTiles(fatBox, [&contactCache](ISceneObject *tileObject, const collision::Box2 &tileBox) {
+      contactCache.addStaticCandidate(tileObject, tileBox);
+      return true;
+    });
+    collisionWorld->VisitCandidates({fatBox.x1, fatBox.y2, fatBox.x2, fatBox.y1}, [&contactCache](ISceneObject *terrainObject) {
+      for(auto & terrainObjectSolidArea : terrainObject->GetSolidAreas()) {
+        contactCache.addStaticCandidate(terrainObject, terrainObjectSolidArea.box);
+      }
+      return true;
+    }, COLLISION_LAYER_TERRAIN);
+  }
+
+  collisionWorld->VisitCandidates(objectPtr->GetBounds(), [objectPtr, &contactCache](ISceneObject *candidateObject) {
+    if(candidateObject == objectPtr) return true;
+    for(auto & candidateObjectSolidArea : candidateObject->GetSolidAreas()) {
+      contactCache.addDynamicCandidate(candidateObject, candidateObjectSolidArea.box);
+    }
+    return true;
+  }, COLLISION_LAYER_MOBILE);
+
+  // Penetrations are measured along the last direction the body moved, also while it stands still. The narrow phase
+  // is skipped if nothing changed since the previous pass.
+  bool bodyIsQuiet = (objectPtr->vectorDirection.x == 0) && (objectPtr->vectorDirection.y == 0);
+  collision::vec2<int16_t> &direction = bodyIsQuiet ? objectPtr->prevVectorDirection : objectPtr->vectorDirection;
+  body.groundEvent = contactCache.update(collisionDetector, direction);
+  for(auto & contact : contactCache.contacts()) {
+    pairs.push_back({contact.object, contact.penetration.depth.x, contact.penetration.depth.y});
+  }
+  body.contactCount = pairs.size() - body.firstPair;
+}
+
+// Position of the body out of its contacts, computed from the positions every object had before the resolution
+void KinematicBodySystem::Resolve(KinematicBody &body) {
+  ISceneObject *objectPtr = body.object;
+  body.contacts = pairs.data() + body.firstPair;
+  body.resolvedPosition = objectPtr->position;
+  body.penetration_x = 0;
+  body.penetration_y = 0;
+  body.diagonal = (objectPtr->vectorDirection.x != 0) && (objectPtr->vectorDirection.y != 0);
+  if(body.contactCount == 0) return;
+
+  if(!body.diagonal) {
+    // Non diagonal displacement: push the body out along both axes by the deepest penetrations
+    for(uint16_t i = 0; i < body.contactCount; i++) {
+      const ObjectCollisionData &contact = body.contacts[i];
+      if(std::abs(contact.penetration_y) > std::abs(body.penetration_y)) body.penetration_y = contact.penetration_y;
+      if(std::abs(contact.penetration_x) > std::abs(body.penetration_x)) body.penetration_x = contact.penetration_x;
+    }
+    body.resolvedPosition.addX(float(-body.penetration_x));
+    body.resolvedPosition.addY(float(-body.penetration_y));
+  } else {
+    // Go back along the trajectory to the exact time of impact
+    sweepTargetBoxes.clear();
+    for(uint16_t i = 0; i < body.contactCount; i++) {
+      for(auto & solidArea : body.contacts[i].object->GetSolidAreas()) sweepTargetBoxes.push_back(&solidArea.box);
+    }
+    sweepMovingBoxes.clear();
+    for(auto & solidArea : objectPtr->GetSolidAreas()) sweepMovingBoxes.push_back(&solidArea.box);
+    collisionDetector.updateWithNonCollidingPosition(sweepTargetBoxes, sweepMovingBoxes, body.resolvedPosition);
+  }
+}
+
+void KinematicBodySystem::Update() {
+  // One pair list for all the bodies
+  pairs.clear();
+  for(auto & body : bodies) GatherPairs(body);
+
+  // Every body is resolved before any position changes, then all of them are written back at once
+  for(auto & body : bodies) Resolve(body);
+  for(auto & body : bodies) {
+    if(body.contactCount) body.object->position = body.resolvedPosition;
+  }
+
+  // Bodies react to their contacts, which may change their sprite, and the broad phase gets their final bounds
+  for(auto & body : bodies) {
+    if((body.contactCount == 0) && (body.groundEvent == collision::CONTACT_EVENT_NONE)) continue;
+    body.object->OnCollisionsResolved(body);
+    collisionWorld->UpdateObject(body.object);
+  }
+}
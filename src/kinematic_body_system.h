@@ -0,0 +1,57 @@
+#ifndef KINEMATIC_BODY_SYSTEM_H
+#define KINEMATIC_BODY_SYSTEM_H
+
+#include <vector>
+#include <position.h>
+#include <collision/collision.h>
+#include "collision_world.h"
+
+class ISceneObject;
+
+// Contact of a kinematic body with a solid object, penetration of the body measured along its direction
+struct ObjectCollisionData { ISceneObject* object; int16_t penetration_x; int16_t penetration_y; };
+
+// Mobile object whose solid areas are kept out of the solid areas of the rest of the world by the kinematic body
+// system. Holds its contacts between frames and, after every pass, the outcome of its resolution.
+struct KinematicBody
+{
+  ISceneObject *object = nullptr;
+  collision::ContactCache<ISceneObject*> contactCache{8.0f};
+  std::vector<collision::Box2> solidBoxes;
+
+  // Outcome of the last pass: range of the body in the pair list, how it was resolved and its ground transition
+  uint32_t firstPair = 0;
+  const ObjectCollisionData *contacts = nullptr;
+  uint16_t contactCount = 0;
+  bool diagonal = false; // moved back along its trajectory instead of pushed out along the axes
+  int16_t penetration_x = 0, penetration_y = 0; // deepest penetrations, pushed out along the axes
+  collision::ContactEvent groundEvent = collision::CONTACT_EVENT_NONE;
+  Position resolvedPosition;
+
+  // Objects currently sustaining the body from the bottom side
+  const std::vector<ISceneObject*>& GroundObjects() const { return contactCache.groundObjects(); }
+};
+
+// Collision resolution shared by every mobile object. Once all of them have moved, a single pass gathers the
+// candidates of every body into one pair list, resolves all the bodies from the positions they reached (so the
+// outcome doesn't depend on the order they moved) and writes the positions back. Bodies are visited in uniqueId
+// order and only bodies with contacts or a ground transition get their OnCollisionsResolved call, so the cost grows
+// with the pairs instead of with the objects.
+class KinematicBodySystem
+{
+  CollisionWorld *collisionWorld;
+  std::vector<KinematicBody> bodies; // sorted by the uniqueId of their object
+  std::vector<ObjectCollisionData> pairs;
+  collision::CollisionDetector collisionDetector;
+  std::vector<const collision::Box2*> sweepTargetBoxes; // scratch of the diagonal resolution
+  std::vector<const collision::Box2*> sweepMovingBoxes;
+  void GatherPairs(KinematicBody&);
+  void Resolve(KinematicBody&);
+public:
+  KinematicBodySystem(CollisionWorld*);
+  void AddBody(ISceneObject*);
+  void RemoveBody(ISceneObject*);
+  void Update();
+};
+
+#endif
@@ -0,0 +1,145 @@
+#include "level_map.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static uint32_t AlignToPage(uint32_t size) {
+  return (size + LEVEL_FILE_PAGE_SIZE - 1) / LEVEL_FILE_PAGE_SIZE * LEVEL_FILE_PAGE_SIZE;
+}
+
+LevelMap::LevelMap() {
+}
+
+LevelMap::~LevelMap() {
+  Close();
+}
+
+bool LevelMap::Open(const std::string &path) {
+  Close();
+  fileDescriptor = open(path.c_str(), O_RDONLY);
+  if(fileDescriptor < 0) {
+    std::cout << "Failed to open level " << path << std::endl;
+    return false;
+  }
+
+  struct stat fileStatus;
+  if((fstat(fileDescriptor, &fileStatus) != 0) || (size_t(fileStatus.st_size) < sizeof(LevelFileHeader))) {
+    std::cout << "Invalid level " << path << std::endl;
+    Close();
+    return false;
+  }
+  dataSize = fileStatus.st_size;
+  void *mapping = mmap(nullptr, dataSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+  if(mapping == MAP_FAILED) {
+    std::cout << "Failed to map level " << path << std::endl;
+    Close();
+    return false;
+  }
+  data = static_cast<const uint8_t*>(mapping);
+
+  // Every chunk must hold its rows (and their metadata) and every chunk must lie inside the file, so Row and
+  // CellMetadata never read past the mapping
+  const LevelFileHeader *fileHeader = reinterpret_cast<const LevelFileHeader*>(data);
+  uint32_t chunkCount = (fileHeader->rowsPerChunk != 0) ? (fileHeader->height + fileHeader->rowsPerChunk - 1) / fileHeader->rowsPerChunk : 0;
+  uint64_t chunkCells = uint64_t(fileHeader->rowsPerChunk) * fileHeader->width;
+  uint64_t chunkBytes = chunkCells * sizeof(uint16_t) + ((fileHeader->flags & LEVEL_FILE_CELL_METADATA) ? chunkCells : 0);
+  bool valid = (std::memcmp(fileHeader->magic, "RLVL", 4) == 0) && (fileHeader->version == LEVEL_FILE_VERSION) &&
+               (fileHeader->width != 0) && (fileHeader->rowsPerChunk != 0) &&
+               (fileHeader->chunkSize >= chunkBytes) && (fileHeader->chunkSize % LEVEL_FILE_PAGE_SIZE == 0) &&
+               (fileHeader->firstChunkOffset >= sizeof(LevelFileHeader)) && (fileHeader->firstChunkOffset % LEVEL_FILE_PAGE_SIZE == 0) &&
+               (uint64_t(fileHeader->firstChunkOffset) + uint64_t(fileHeader->chunkSize) * chunkCount <= dataSize);
+  if(!valid) {
+    std::cout << "Invalid level " << path << std::endl;
+    Close();
+    return false;
+  }
+  header = fileHeader;
+  firstKeptChunk = 0;
+  return true;
+}
+
+void LevelMap::Close() {
+  if(data != nullptr) munmap(const_cast<uint8_t*>(data), dataSize);
+  if(fileDescriptor >= 0) close(fileDescriptor);
+  data = nullptr;
+  dataSize = 0;
+  header = nullptr;
+  fileDescriptor = -1;
+}
+
+const uint8_t* LevelMap::Chunk(uint32_t chunk) const {
+  return data + header->firstChunkOffset + size_t(chunk) * header->chunkSize;
+}
+
+const uint16_t* LevelMap::Row(uint32_t row) const {
+  if((header == nullptr) || (row >= header->height)) return nullptr;
+  const uint8_t *chunk = Chunk(row / header->rowsPerChunk);
+  return reinterpret_cast<const uint16_t*>(chunk) + size_t(row % header->rowsPerChunk) * header->width;
+}
+
+uint8_t LevelMap::CellMetadata(uint32_t row, uint16_t column) const {
+  if((header == nullptr) || !(header->flags & LEVEL_FILE_CELL_METADATA)) return 0;
+  if((row >= header->height) || (column >= header->width)) return 0;
+  const uint8_t *chunk = Chunk(row / header->rowsPerChunk);
+  const uint8_t *metadata = chunk + size_t(header->rowsPerChunk) * header->width * sizeof(uint16_t);
+  return metadata[size_t(row % header->rowsPerChunk) * header->width + column];
+}
+
+void LevelMap::KeepRows(uint32_t firstRow, uint32_t lastRow) {
+  if((header == nullptr) || (firstRow >= header->height)) return;
+  if(lastRow >= header->height) lastRow = header->height - 1;
+  uint32_t firstChunk = firstRow / header->rowsPerChunk;
+  uint32_t lastChunk = lastRow / header->rowsPerChunk;
+
+  // Chunks left behind by the camera are read again from the file if they are ever needed
+  if(firstChunk > firstKeptChunk) {
+    madvise(const_cast<uint8_t*>(Chunk(firstKeptChunk)), size_t(firstChunk - firstKeptChunk) * header->chunkSize, MADV_DONTNEED);
+    firstKeptChunk = firstChunk;
+  }
+  madvise(const_cast<uint8_t*>(Chunk(firstChunk)), size_t(lastChunk - firstChunk + 1) * header->chunkSize, MADV_WILLNEED);
+}
+
+bool LevelMap::Write(const std::string &path, uint16_t width, uint32_t height, uint16_t rowsPerChunk,
+                     const std::vector<uint16_t> &ids, const std::vector<uint8_t> &metadata) {
+  bool hasMetadata = !metadata.empty();
+  if((width == 0) || (rowsPerChunk == 0) || (ids.size() != size_t(width) * height) ||
+     (hasMetadata && (metadata.size() != ids.size()))) {
+    return false;
+  }
+
+  LevelFileHeader fileHeader;
+  std::memset(&fileHeader, 0, sizeof(fileHeader));
+  std::memcpy(fileHeader.magic, "RLVL", 4);
+  fileHeader.version = LEVEL_FILE_VERSION;
+  fileHeader.flags = hasMetadata ? LEVEL_FILE_CELL_METADATA : 0;
+  fileHeader.width = width;
+  fileHeader.rowsPerChunk = rowsPerChunk;
+  fileHeader.height = height;
+  fileHeader.chunkSize = AlignToPage(uint32_t(rowsPerChunk) * width * (sizeof(uint16_t) + (hasMetadata ? 1 : 0)));
+  fileHeader.firstChunkOffset = AlignToPage(sizeof(LevelFileHeader));
+
+  FILE *file = fopen(path.c_str(), "wb");
+  if(file == nullptr) return false;
+  std::vector<uint8_t> chunk(fileHeader.firstChunkOffset, 0);
+  std::memcpy(chunk.data(), &fileHeader, sizeof(fileHeader));
+  bool written = fwrite(chunk.data(), 1, chunk.size(), file) == chunk.size();
+
+  uint32_t chunkCount = (height + rowsPerChunk - 1) / rowsPerChunk;
+  for(uint32_t c = 0; written && (c < chunkCount); c++) {
+    chunk.assign(fileHeader.chunkSize, 0);
+    uint32_t firstRow = c * rowsPerChunk;
+    uint32_t rows = std::min<uint32_t>(rowsPerChunk, height - firstRow);
+    size_t cells = size_t(rows) * width;
+    std::memcpy(chunk.data(), ids.data() + size_t(firstRow) * width, cells * sizeof(uint16_t));
+    if(hasMetadata) {
+      std::memcpy(chunk.data() + size_t(rowsPerChunk) * width * sizeof(uint16_t), metadata.data() + size_t(firstRow) * width, cells);
+    }
+    written = fwrite(chunk.data(), 1, chunk.size(), file) == chunk.size();
+  }
+  return (fclose(file) == 0) && written;
+}
@@ -0,0 +1,68 @@
+#ifndef LEVEL_MAP_H
+#define LEVEL_MAP_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Level file (.lvl), cooked by rocket_level_cooker. Little endian, laid out as:
+//   LevelFileHeader
+//   chunk 0, chunk 1, ... each one holding rowsPerChunk rows, from the bottom row of the level up
+// A chunk is the tile ids of its rows (one uint16_t SceneObjectIdentificator per cell, 0 for an empty cell) followed,
+// when the level has cell metadata, by one byte per cell. Every chunk starts at a multiple of the page size, so the
+// chunks the camera left behind can be given back to the system one by one.
+struct LevelFileHeader {
+  char magic[4]; // "RLVL"
+  uint16_t version;
+  uint16_t flags; // LevelFileFlags
+  uint16_t width; // cells
+  uint16_t rowsPerChunk;
+  uint32_t height; // rows
+  uint32_t chunkSize; // bytes, page aligned
+  uint32_t firstChunkOffset; // bytes, page aligned
+};
+
+enum LevelFileFlags: uint16_t { LEVEL_FILE_CELL_METADATA = 0x01 };
+
+const uint16_t LEVEL_FILE_VERSION = 1;
+const uint32_t LEVEL_FILE_PAGE_SIZE = 16384; // largest page size of the supported systems
+
+// Read only view of a level file mapped in memory. Rows are read straight from the mapping, so the system loads
+// them the first time they are touched, and KeepRows gives back the chunks out of the rows still needed: the memory
+// used stays the same whatever the height of the level.
+class LevelMap
+{
+  int fileDescriptor = -1;
+  const uint8_t *data = nullptr;
+  size_t dataSize = 0;
+  const LevelFileHeader *header = nullptr;
+  uint32_t firstKeptChunk = 0;
+  const uint8_t* Chunk(uint32_t chunk) const;
+public:
+  LevelMap();
+  ~LevelMap();
+
+  // Maps the level file. Returns false if it doesn't exist or it isn't a valid level file.
+  bool Open(const std::string &path);
+  void Close();
+  bool IsOpen() const { return header != nullptr; }
+  uint16_t Width() const { return header ? header->width : 0; }
+  uint32_t Height() const { return header ? header->height : 0; }
+
+  // Tile ids of a row, counted from the bottom row of the level. Null past the top of the level.
+  const uint16_t* Row(uint32_t row) const;
+
+  // Metadata byte of a cell, 0 when the level has no metadata
+  uint8_t CellMetadata(uint32_t row, uint16_t column) const;
+
+  // Only rows firstRow..lastRow will be read from now on: their chunks are requested in advance and the chunks below
+  // them are dropped from memory
+  void KeepRows(uint32_t firstRow, uint32_t lastRow);
+
+  // Writes a level file. ids holds width cells per row from the bottom row up, metadata the same cells or nothing.
+  static bool Write(const std::string &path, uint16_t width, uint32_t height, uint16_t rowsPerChunk,
+                    const std::vector<uint16_t> &ids, const std::vector<uint8_t> &metadata);
+};
+
+#endif
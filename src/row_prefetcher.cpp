@@ -0,0 +1,122 @@
+#include "row_prefetcher.h"
+#include "scene_object_factory.h"
+
+RowPrefetcher::RowPrefetcher(SceneObjectDataManager* _textureManager, CollisionWorld* _collisionWorld, const LevelMap* _levelMap, uint16_t _cell_w, uint16_t _cell_h) {
+  textureManager = _textureManager;
+  collisionWorld = _collisionWorld;
+  levelMap = _levelMap;
+  cell_w = _cell_w;
+  cell_h = _cell_h;
+  worker = std::thread(&RowPrefetcher::Run, this);
+}
+
+RowPrefetcher::~RowPrefetcher() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  condition.notify_all();
+  worker.join();
+  DeleteBand(band);
+  for(auto & kindObjects : recycledObjects) {
+    for(auto objectPtr : kindObjects.second) delete objectPtr;
+  }
+}
+
+void RowPrefetcher::Request(uint32_t firstRow, uint16_t rows, uint16_t firstScreenRow) {
+  std::unique_lock<std::mutex> lock(mutex);
+  condition.wait(lock, [this] { return !requested || ready; });
+  DeleteBand(band);
+  requestedRow = firstRow;
+  requestedRows = rows;
+  requestedScreenRow = firstScreenRow;
+  requested = true;
+  ready = false;
+  lock.unlock();
+  condition.notify_all();
+}
+
+void RowPrefetcher::Take(RowBand &readyBand) {
+  std::unique_lock<std::mutex> lock(mutex);
+  condition.wait(lock, [this] { return !requested || ready; });
+  readyBand = std::move(band);
+  band = RowBand();
+  requested = false;
+  ready = false;
+}
+
+void RowPrefetcher::Recycle(const std::vector<ISceneObject*> &droppedObjects) {
+  std::lock_guard<std::mutex> lock(mutex);
+  for(auto objectPtr : droppedObjects) {
+    if(objectPtr->Type() == SceneObjectType::TERRAIN) {
+      std::vector<ISceneObject*> &kindObjects = recycledObjects[objectPtr->Id()];
+      if(kindObjects.size() < MAX_RECYCLED_OBJECTS_PER_KIND) {
+        kindObjects.push_back(objectPtr);
+        continue;
+      }
+    }
+    delete objectPtr;
+  }
+}
+
+ISceneObject* RowPrefetcher::TakeRecycledObject(SceneObjectIdentificator obj_id) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = recycledObjects.find(obj_id);
+  if((it == recycledObjects.end()) || it->second.empty()) return nullptr;
+  ISceneObject *objectPtr = it->second.back();
+  it->second.pop_back();
+  return objectPtr;
+}
+
+void RowPrefetcher::Run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while(true) {
+    condition.wait(lock, [this] { return stopping || (requested && !ready); });
+    if(stopping) return;
+
+    // The band is built out of the lock: the logic thread only waits for it when it needs it
+    uint32_t firstRow = requestedRow;
+    uint16_t rows = requestedRows;
+    uint16_t firstScreenRow = requestedScreenRow;
+    lock.unlock();
+    RowBand builtBand;
+    BuildBand(firstRow, rows, firstScreenRow, builtBand);
+    lock.lock();
+
+    std::swap(band, builtBand);
+    ready = true;
+    condition.notify_all();
+  }
+}
+
+void RowPrefetcher::BuildBand(uint32_t firstRow, uint16_t rows, uint16_t firstScreenRow, RowBand &builtBand) {
+  builtBand.firstRow = firstRow;
+  for(uint16_t row=0; row<rows; row++) {
+    // Past the top of the level the rows are left empty
+    const uint16_t *levelRow = levelMap->Row(firstRow + row);
+    std::vector<ISceneObject*> rowObjects;
+    for(uint16_t x=0; levelRow && (x<levelMap->Width()); x++) {
+      if(SceneObjectIdentificator obj_id = (SceneObjectIdentificator)levelRow[x]) {
+        SceneObjectFactory *factory = SceneObjectFactory::Get(textureManager, collisionWorld);
+        ISceneObject *objectPtr = TakeRecycledObject(obj_id);
+        objectPtr = objectPtr ? factory->RecycleSceneObject(objectPtr, false) : factory->CreateSceneObject(obj_id, false);
+        if(objectPtr) {
+          objectPtr->position.setX(int16_t(x*cell_w));
+          objectPtr->position.setY(int16_t((firstScreenRow+row)*cell_h));
+          rowObjects.push_back(objectPtr);
+
+          // Initial update to load the sprites and boundary box before inserting the object into the broad phase
+          objectPtr->Update();
+          builtBand.objects.push_back(objectPtr);
+        }
+      }
+    }
+    builtBand.rows.push_back(rowObjects);
+  }
+}
+
+void RowPrefetcher::DeleteBand(RowBand &unusedBand) {
+  for(auto objectPtr : unusedBand.objects) delete objectPtr;
+  unusedBand.objects.clear();
+  unusedBand.rows.clear();
+}
@@ -0,0 +1,71 @@
+#ifndef ROW_PREFETCHER_H
+#define ROW_PREFETCHER_H
+
+#include <vector>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "scene_object.h"
+#include "scene_object_data_manager.h"
+#include "collision_world.h"
+#include "level_map.h"
+
+// Objects of a band of rows of the level, built and ready to be added to the scene
+struct RowBand {
+  uint32_t firstRow = 0; // level row of rows[0]
+  std::vector<std::vector<ISceneObject*>> rows;
+  std::vector<ISceneObject*> objects; // all the objects of the rows, for the bulk insertion into the broad phase
+};
+
+const uint16_t MAX_RECYCLED_OBJECTS_PER_KIND = 256;
+
+// Builds the next band of rows on a worker thread while the camera scrolls, so the scroll only has to take it.
+// Objects are created by SceneObjectFactory, given their initial position (screen rows from firstScreenRow up) and
+// updated once to load their sprite.
+// Threading rule: the collision world belongs to the logic thread and has no locking. The worker never touches it:
+// the objects it builds have no collision world (SetCollisionWorld is called by the logic thread when it takes the
+// band, before adding the objects to the broad phase), so their Update can't reach it. collisionWorld is only kept
+// to get the factory.
+// The terrain of the rows the camera left behind is handed back and reused for the cells of the same kind of the
+// next bands, so a long climb doesn't allocate new objects.
+class RowPrefetcher
+{
+  SceneObjectDataManager *textureManager;
+  CollisionWorld *collisionWorld; // never used by the worker, see above
+  const LevelMap *levelMap;
+  uint16_t cell_w, cell_h;
+
+  std::thread worker;
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool requested = false;
+  bool ready = false;
+  bool stopping = false;
+  uint32_t requestedRow = 0;
+  uint16_t requestedRows = 0;
+  uint16_t requestedScreenRow = 0;
+  RowBand band;
+  std::map<SceneObjectIdentificator, std::vector<ISceneObject*>> recycledObjects; // by kind
+
+  void Run();
+  ISceneObject* TakeRecycledObject(SceneObjectIdentificator);
+  void BuildBand(uint32_t, uint16_t, uint16_t, RowBand&);
+  void DeleteBand(RowBand&);
+public:
+  RowPrefetcher(SceneObjectDataManager*, CollisionWorld*, const LevelMap*, uint16_t, uint16_t);
+  ~RowPrefetcher();
+
+  // Starts building the level rows firstRow..firstRow+rows-1, placed on the screen from row firstScreenRow up.
+  // A band built before and not taken is dropped.
+  void Request(uint32_t firstRow, uint16_t rows, uint16_t firstScreenRow);
+
+  // Moves the requested band into readyBand, waiting for the worker if it isn't finished yet
+  void Take(RowBand &readyBand);
+
+  // Takes the objects of the rows dropped from the scene, already out of the collision world. Terrain is kept to be
+  // reused, any other object is deleted.
+  void Recycle(const std::vector<ISceneObject*> &droppedObjects);
+};
+
+#endif
@@ -20,68 +20,105 @@ ISceneObject::ISceneObject(SceneObjectIdentificator _id, SceneObjectType _type,
   recalculateAreasDataIsNeeded = true;
 }
 
-void ISceneObject::SetSpacePartitionObjectsTree(aabb::Tree<ISceneObject*> *_spacePartitionObjectsTree) {
-  spacePartitionObjectsTree = _spacePartitionObjectsTree;
+void ISceneObject::SetCollisionWorld(CollisionWorld *_collisionWorld) {
+  collisionWorld = _collisionWorld;
 }
 
-std::vector<Area>& ISceneObject::GetSolidAreas() {
-  if(recalculateAreasDataIsNeeded) {
-    // Updates the object solid areas values according to the current object position and current sprite areas
-    solidAreas.clear();
-    if(currentSprite.areas!=nullptr) {
-      for(uint16_t i=0; i<currentSprite.areas->solidAreas.size(); i++) {
-        std::vector<collision::vec2<float>> updatedPoints;
-        std::vector<collision::vec2<float>> &currentPoints = currentSprite.areas->solidAreas.at(i).rectangle.vertices;
-        for(uint16_t j=0; j<currentPoints.size(); j++) {
-          // Apply the current position to the current area point
-          updatedPoints.push_back(collision::vec2<float>(currentPoints.at(j).x + position.GetX(), currentPoints.at(j).y + position.GetY()));
-        }
-        collision::Rectangle updatedRectangle(updatedPoints);
-        solidAreas.push_back({currentSprite.areas->solidAreas.at(i).id, updatedRectangle});
-      }
+void ISceneObject::Reset() {
+  currentState = 0;
+  position = Position();
+  vectorDirection.x = vectorDirection.y = 0;
+  prevVectorDirection.x = prevVectorDirection.y = 0;
+  currentSprite = Sprite();
+  boundingBox = {0, 0, 0, 0};
+  areasSprite = nullptr;
+  recalculateAreasDataIsNeeded = true;
+}
+
+static void TranslateAreas(std::vector<Area> &areas, const std::vector<Area> &spriteAreas, float x, float y) {
+  for(size_t i=0; i<areas.size(); i++) {
+    areas[i].box = spriteAreas[i].box.translated(x, y);
+  }
+}
+
+// Keeps the world space areas in sync with the current sprite and position without reallocating them: the area
+// lists are only resized when the sprite changes and the boxes are only moved when the position changes
+void ISceneObject::UpdateAreas() {
+  bool spriteChanged = recalculateAreasDataIsNeeded || (areasSprite != currentSprite.areas);
+  if(spriteChanged) {
+    areasSprite = currentSprite.areas;
+    if(areasSprite != nullptr) {
+      solidAreas.assign(areasSprite->solidAreas.begin(), areasSprite->solidAreas.end());
+      simpleAreas.assign(areasSprite->simpleAreas.begin(), areasSprite->simpleAreas.end());
+    } else {
+      solidAreas.clear();
+      simpleAreas.clear();
     }
     recalculateAreasDataIsNeeded = false;
   }
+  if(areasSprite == nullptr) return;
+
+  // The boxes are translated from the sprite areas, not from their previous position, so rounding never accumulates
+  float x = position.GetX();
+  float y = position.GetY();
+  if(spriteChanged || (x != areasX) || (y != areasY)) {
+    TranslateAreas(solidAreas, areasSprite->solidAreas, x, y);
+    TranslateAreas(simpleAreas, areasSprite->simpleAreas, x, y);
+    areasX = x;
+    areasY = y;
+  }
+}
+
+std::vector<Area>& ISceneObject::GetSolidAreas() {
+  UpdateAreas();
   return solidAreas;
 }
 
 std::vector<Area>& ISceneObject::GetSimpleAreas() {
+  UpdateAreas();
+  return simpleAreas;
+}
 
+uint16_t ISceneObject::CollisionCategories() {
+  return (currentSprite.areas != nullptr) ? currentSprite.areas->categories : 0;
+}
+
+uint16_t ISceneObject::TriggerMask() {
+  return (currentSprite.areas != nullptr) ? currentSprite.areas->triggerMask : 0;
+}
+
+void ISceneObject::OnTrigger(const Area &area, ISceneObject *other, const Area &otherArea) {
+}
+
+void ISceneObject::OnCollisionsResolved(const KinematicBody &body) {
 }
 
 void ISceneObject::PositionSetXY(float x, float y) {
     position.setXY(x, y);
-    recalculateAreasDataIsNeeded = true;
 }
 
 void ISceneObject::PositionSetX(float x) {
   position.setX(x);
-  recalculateAreasDataIsNeeded = true;
 }
 
 void ISceneObject::PositionSetY(float y) {
   position.setY(y);
-  recalculateAreasDataIsNeeded = true;
 }
 
 void ISceneObject::PositionAddX(float x) {
   position.addX(x);
-  recalculateAreasDataIsNeeded = true;
 }
 
 void ISceneObject::PositionAddY(float y) {
   position.addY(y);
-  recalculateAreasDataIsNeeded = true;
 }
 
 void ISceneObject::PositionSetOffset(int16_t x, int16_t y) {
   position.setOffset(x, y);
-  recalculateAreasDataIsNeeded = true;
 }
 
 void ISceneObject::RecoverPreviousPosition() {
   position.recoverPreviousPosition();
-  recalculateAreasDataIsNeeded = true;
 }
 
 std::vector<uint16_t> ISceneObject::GetLowerBound() {
@@ -94,6 +131,14 @@ std::vector<uint16_t> ISceneObject::GetUpperBound() {
   return upperBound;
 }
 
+// Bounding box in screen coordinates without temporary vectors. Signed arithmetic so objects partially scrolled out
+// of the screen (negative y) keep valid bounds.
+collision::Bounds2 ISceneObject::GetBounds() {
+  int32_t x = position.GetIntX();
+  int32_t y = position.GetIntY();
+  return { float(x + boundingBox.lowerBoundX), float(y + boundingBox.lowerBoundY), float(x + boundingBox.upperBoundX), float(y + boundingBox.upperBoundY) };
+}
+
 SceneObjectIdentificator ISceneObject::Id() {
   return id;
 }
@@ -9,23 +9,30 @@
 #include <sprite.h>
 #include <state_machine.h>
 #include <AABB/AABB.h>
+#include <collision_world.h>
 
 using namespace std;
 
+struct KinematicBody;
+
 struct Boundaries { uint16_t lowerBoundX, lowerBoundY, upperBoundX, upperBoundY; };
 
 class ISceneObject : public StateMachine
 {
 private:
+  // World space areas, kept in fixed storage: rebuilt when the sprite changes and translated when the position changes
   std::vector<Area> solidAreas;
   std::vector<Area> simpleAreas;
+  SpriteAreas *areasSprite = nullptr; // sprite areas the world space areas were built from
+  float areasX = 0.0f, areasY = 0.0f; // position the world space areas are translated to
+  void UpdateAreas();
 protected:
-  aabb::Tree<ISceneObject*> *spacePartitionObjectsTree = nullptr;
+  CollisionWorld *collisionWorld = nullptr;
   ObjectSpriteSheet *spriteSheet = nullptr;
   SceneObjectIdentificator id;
   SceneObjectType type;
   chrono::system_clock::time_point nextSpriteTime;
-  bool recalculateAreasDataIsNeeded = true;
+  bool recalculateAreasDataIsNeeded = true; // set when the current sprite changes
 public:
   ISceneObject();
   ISceneObject(SceneObjectIdentificator, SceneObjectType, unsigned char);
@@ -33,9 +40,25 @@ class ISceneObject : public StateMachine
   Position position;
   Boundaries boundingBox;
   uint32_t uniqueId;
-  void SetSpacePartitionObjectsTree(aabb::Tree<ISceneObject*>*);
+  collision::BroadphaseHandle broadphaseHandle = collision::NULL_BROADPHASE_HANDLE; // set by CollisionWorld
+  uint8_t collisionLayer = 0; // CollisionLayer holding the object, set by CollisionWorld along with broadphaseHandle
+  void SetCollisionWorld(CollisionWorld*);
+  // Back to the state of a new object, so it can be reused for another cell once it has left the collision world.
+  // Keeps the storage of its areas. InitWithSpriteSheet must be called again.
+  void Reset();
   std::vector<Area>& GetSolidAreas();
   std::vector<Area>& GetSimpleAreas();
+  uint16_t CollisionCategories(); // categories of every area of the current sprite
+  uint16_t TriggerMask(); // categories the simple areas of the current sprite trigger on
+  // Called by the trigger pass on both objects when a trigger area overlaps an area of the other object whose category
+  // is in its mask. Must not add or remove objects of the collision world.
+  virtual void OnTrigger(const Area &area, ISceneObject *other, const Area &otherArea);
+  // Direction of the displacement of the last update and the last non null one, read by the kinematic body pass
+  collision::vec2<int16_t> vectorDirection;
+  collision::vec2<int16_t> prevVectorDirection;
+  // Called by the kinematic body pass once the object has been moved out of the solid objects it collided with or
+  // when it lands on or leaves the ground
+  virtual void OnCollisionsResolved(const KinematicBody &body);
   void PositionSetOffset(int16_t x, int16_t y);
   void PositionSetXY(float, float);
   void PositionSetX(float);
@@ -45,6 +68,7 @@ class ISceneObject : public StateMachine
   void RecoverPreviousPosition();
   virtual std::vector<uint16_t> GetLowerBound();
   virtual std::vector<uint16_t> GetUpperBound();
+  collision::Bounds2 GetBounds();
   virtual SceneObjectIdentificator Id();
   virtual SceneObjectType Type();
   virtual void InitWithSpriteSheet(ObjectSpriteSheet*);
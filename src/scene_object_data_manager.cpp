@@ -1,6 +1,9 @@
 #include "scene_object_data_manager.h"
 #include <fstream>
 #include <sstream>
+#include <cmath>
+#include <cstring>
+#include <climits>
 #include <utils.h>
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -8,6 +11,17 @@
 
 using namespace collision;
 
+// Category of a collision area given its name in objtypes.dat and the categories it triggers on by default
+static bool CollisionCategoryFromName(const std::string &name, uint16_t &category, uint16_t &mask)
+{
+        if(name == "solid") { category = COLLISION_CATEGORY_SOLID; mask = COLLISION_CATEGORY_SOLID; }
+        else if(name == "body") { category = COLLISION_CATEGORY_BODY; mask = 0; }
+        else if(name == "hammer") { category = COLLISION_CATEGORY_HAMMER; mask = COLLISION_CATEGORY_SOLID; }
+        else if(name == "pickup") { category = COLLISION_CATEGORY_PICKUP; mask = COLLISION_CATEGORY_BODY; }
+        else return false;
+        return true;
+}
+
 SceneObjectDataManager::SceneObjectDataManager()
 {
         cout << "SceneObjectDataManager created!" << endl;
@@ -26,7 +40,9 @@ SceneObjectDataManager::~SceneObjectDataManager() {
 
 void SceneObjectDataManager::Print()
 {
-        printf("Texture filename: %s\n", textureFilename.c_str());
+        for(uint16_t page=0; page<textureFilenames.size(); page++) {
+                printf("Texture filename (page %d): %s\n", page, textureFilenames[page].c_str());
+        }
         printf("Total object sprite sheets: %lu\n", objectSpriteSheetsMap.size());
         for (auto& kv : objectSpriteSheetsMap) {
                 ObjectSpriteSheet* objectSpriteSheet = kv.second;
@@ -36,7 +52,7 @@ void SceneObjectDataManager::Print()
 
 void SceneObjectDataManager::LoadObjectsDataFromFile(std::string filename)
 {
-        enum LineType { OBJ_TEX_FILENAME, OBJ_ID, OBJ_ANIMATION_ID, OBJ_SPRITE, OBJ_SPRITE_COLLISION_AREA };
+        enum LineType { OBJ_TEX_FILENAME, OBJ_ID, OBJ_ANIMATION_ID, OBJ_SPRITE, OBJ_SPRITE_COLLISION_AREA, OBJ_PALETTE_SWAP, OBJ_SPRITE_TABLE_FILENAME };
 
         std::ifstream infile(filename);
         std::string line;
@@ -44,6 +60,7 @@ void SceneObjectDataManager::LoadObjectsDataFromFile(std::string filename)
         ObjectSpriteSheetAnimation *currentObjectSpriteSheetAnimation;
         uint16_t currentObjectSpriteSheetAnimationId;
         SpriteAreas *currentAreas;
+        uint16_t currentAtlasPage = 0;
 
         while (std::getline(infile, line))
         {
@@ -58,7 +75,13 @@ void SceneObjectDataManager::LoadObjectsDataFromFile(std::string filename)
                                 commentFound = true;
                         } else if(startsWith(token, "###")) {
                                 currentLineType = OBJ_TEX_FILENAME;
-                                textureFilename = token.substr(3);
+                                // Sprites, palette swaps and sprite tables that follow belong to this atlas page
+                                if(textureFilenames.size() < MAX_ATLAS_PAGES) {
+                                        textureFilenames.push_back(token.substr(3));
+                                        currentAtlasPage = textureFilenames.size() - 1;
+                                } else {
+                                        std::cout << "Too many texture atlas pages, " << token.substr(3) << " ignored" << std::endl;
+                                }
                         } else if(startsWith(token, "##")) {
                                 currentLineType = OBJ_ID;
                                 SceneObjectIdentificator objectId = (SceneObjectIdentificator)std::stoi(token.substr(2));
@@ -69,11 +92,26 @@ void SceneObjectDataManager::LoadObjectsDataFromFile(std::string filename)
                                 uint16_t objectSpriteSheetAnimationId = std::stoi(token.substr(1));
                                 currentObjectSpriteSheetAnimation = new ObjectSpriteSheetAnimation(objectSpriteSheetAnimationId);
                                 currentObjectSpriteSheet->AddAnimation(currentObjectSpriteSheetAnimation);
+                        } else if(startsWith(token, "@@")) {
+                                currentLineType = OBJ_SPRITE_TABLE_FILENAME;
+                                LoadSpriteTableFromFile(token.substr(2), currentAtlasPage);
+                        } else if(startsWith(token, "%")) {
+                                currentLineType = OBJ_PALETTE_SWAP;
+                                PaletteSwapData paletteSwap;
+                                paletteSwap.id = std::stoi(token.substr(1));
+                                paletteSwap.page = currentAtlasPage;
+                                iss >> paletteSwap.u1 >> paletteSwap.v1 >> paletteSwap.u2 >> paletteSwap.v2 >> paletteSwap.baseU >> paletteSwap.baseV;
+                                paletteSwaps.push_back(paletteSwap);
+                                maxPaletteId = std::max(maxPaletteId, paletteSwap.id);
                         } else if(startsWith(token, "_")) {
                                 currentLineType = OBJ_SPRITE_COLLISION_AREA;
                                 uint16_t collisionAreaId = std::stoi(token.substr(1));
                                 iss >> token;
-                                string collisionAreaType = token; // Type is a string value
+                                // Type is a string value, optionally followed by the category: 'simple:hammer'
+                                size_t categorySeparator = token.find(':');
+                                string collisionAreaType = token.substr(0, categorySeparator);
+                                string collisionAreaCategory = (categorySeparator != string::npos) ? token.substr(categorySeparator + 1) :
+                                                               (collisionAreaType == "solid") ? "solid" : "body";
 
                                 // Creates a temporal vector of tokens of the current line being processed
                                 std::vector<float> *currentCollisionAreaValues = new std::vector<float>;
@@ -89,14 +127,24 @@ void SceneObjectDataManager::LoadObjectsDataFromFile(std::string filename)
                                 }
 
                                 delete currentCollisionAreaValues;
-                                // Initializes a polygon from the array of points
-                                Rectangle rectangle(points);
+                                // Every collision area is axis aligned, keep the box of the polygon points
+                                Box2 box = Box2::fromPoints(points.data(), points.size());
+
+                                // Category and mask of the area. Solid areas always meet the solid areas.
+                                uint16_t category = COLLISION_CATEGORY_BODY, mask = 0;
+                                if(!CollisionCategoryFromName(collisionAreaCategory, category, mask)) {
+                                  std::cout << "Unknown collision area category " << collisionAreaCategory << std::endl;
+                                }
+                                if(collisionAreaType=="solid") mask = COLLISION_CATEGORY_SOLID;
 
-                                // If the polygon corresponds to a solid area then add the polygon to the solidArea vector, otherwise add the polygon to simpleAreas
+                                // If the polygon corresponds to a solid area then add the box to the solidArea vector, otherwise add the box to simpleAreas
                                 if(collisionAreaType=="solid") {
-                                  currentAreas->solidAreas.push_back({ collisionAreaId, rectangle });
+                                  currentAreas->solidAreas.push_back({ collisionAreaId, box, category, mask });
+                                  currentAreas->categories |= category;
                                 } else if(collisionAreaType=="simple") {
-                                  currentAreas->simpleAreas.push_back({ collisionAreaId, rectangle });
+                                  currentAreas->simpleAreas.push_back({ collisionAreaId, box, category, mask });
+                                  currentAreas->categories |= category;
+                                  currentAreas->triggerMask |= mask;
                                 }
 
                         } else {
@@ -106,24 +154,44 @@ void SceneObjectDataManager::LoadObjectsDataFromFile(std::string filename)
                 }
 
                 if(currentLineType == OBJ_SPRITE) {
-                        if(currentFrameValues->size() == 13) {
+                        // UVs are either four values or a single '@<frame name>' value from the sprite table
+                        bool uvsFromSpriteTable = (currentFrameValues->size() > 4) && startsWith(currentFrameValues->at(4), "@");
+                        uint16_t c = uvsFromSpriteTable ? 5 : 8; // index of the first value after the UVs
+
+                        if(currentFrameValues->size() >= c + 5) {
                                 uint16_t width = stoi(currentFrameValues->at(0));
                                 uint16_t height = stoi(currentFrameValues->at(1));
                                 int16_t xOffset = stoi(currentFrameValues->at(2));
                                 int16_t yOffset = stoi(currentFrameValues->at(3));
-                                float u1 = stof(currentFrameValues->at(4));
-                                float v1 = stof(currentFrameValues->at(5));
-                                float u2 = stof(currentFrameValues->at(6));
-                                float v2 = stof(currentFrameValues->at(7));
-                                uint16_t duration = stoi(currentFrameValues->at(8));
-                                uint16_t lowerBoundX = stoi(currentFrameValues->at(9));
-                                uint16_t lowerBoundY = stoi(currentFrameValues->at(10));
-                                uint16_t upperBoundX = stoi(currentFrameValues->at(11));
-                                uint16_t upperBoundY = stoi(currentFrameValues->at(12));
+                                float u1 = 0.0f, v1 = 0.0f, u2 = 0.0f, v2 = 0.0f;
+                                uint16_t atlasPage = currentAtlasPage;
+                                if(uvsFromSpriteTable) {
+                                        auto searchIterator = atlasFrames.find(currentFrameValues->at(4).substr(1));
+                                        if(searchIterator != atlasFrames.end()) {
+                                                AtlasFrameData &frame = searchIterator->second;
+                                                u1 = frame.u1; v1 = frame.v1; u2 = frame.u2; v2 = frame.v2;
+                                                atlasPage = frame.page;
+                                        } else {
+                                                std::cout << "Frame " << currentFrameValues->at(4) << " not found in the sprite table" << std::endl;
+                                        }
+                                } else {
+                                        u1 = stof(currentFrameValues->at(4));
+                                        v1 = stof(currentFrameValues->at(5));
+                                        u2 = stof(currentFrameValues->at(6));
+                                        v2 = stof(currentFrameValues->at(7));
+                                }
+                                uint16_t duration = stoi(currentFrameValues->at(c));
+                                uint16_t lowerBoundX = stoi(currentFrameValues->at(c + 1));
+                                uint16_t lowerBoundY = stoi(currentFrameValues->at(c + 2));
+                                uint16_t upperBoundX = stoi(currentFrameValues->at(c + 3));
+                                uint16_t upperBoundY = stoi(currentFrameValues->at(c + 4));
+                                // Optional palette used to recolour the sprite (0 is the atlas palette)
+                                uint16_t paletteId = (currentFrameValues->size() > c + 5) ? stoi(currentFrameValues->at(c + 5)) : 0;
+                                maxPaletteId = std::max(maxPaletteId, paletteId);
 
                                 // An sprite may contain some areas defined by polygons in order to check possible collisions with other objects during the gameplay
                                 currentAreas = new SpriteAreas();
-                                currentObjectSpriteSheetAnimation->AddSprite({ width, height, xOffset, yOffset, u1, v1, u2, v2, duration, false, lowerBoundX, lowerBoundY, upperBoundX, upperBoundY, currentAreas });
+                                currentObjectSpriteSheetAnimation->AddSprite({ width, height, xOffset, yOffset, u1, v1, u2, v2, duration, false, lowerBoundX, lowerBoundY, upperBoundX, upperBoundY, currentAreas, paletteId, atlasPage });
                         }
                 }
 
@@ -131,39 +199,194 @@ void SceneObjectDataManager::LoadObjectsDataFromFile(std::string filename)
         }
 }
 
+void SceneObjectDataManager::LoadSpriteTableFromFile(std::string filename, uint16_t page)
+{
+        // Sprite table generated by the atlas_packer tool: name u1 v1 u2 v2 width height
+        std::ifstream infile(FileSystem::getPath(filename));
+        std::string line;
+
+        if(!infile) {
+                std::cout << "Failed to load sprite table " << filename << std::endl;
+                return;
+        }
+
+        while (std::getline(infile, line))
+        {
+                if(startsWith(line, "//")) continue;
+
+                std::istringstream iss(line);
+                std::string name;
+                AtlasFrameData frame;
+                frame.page = page;
+                if(iss >> name >> frame.u1 >> frame.v1 >> frame.u2 >> frame.v2) {
+                        atlasFrames[name] = frame;
+                }
+        }
+}
+
 uint32_t SceneObjectDataManager::LoadObjectsTextures() {
-        glGenTextures(1, &textureId);
-        glBindTexture(GL_TEXTURE_2D, textureId);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        std::vector<unsigned char*> pagesData;
+        std::vector<int> pagesWidth, pagesHeight;
+        int maxWidth = 0, maxHeight = 0;
 
-        int width, height, nrChannels;
-        unsigned char *data = stbi_load(FileSystem::getPath(textureFilename).c_str(), &width, &height, &nrChannels, 0);
+        for(auto& textureFilename : textureFilenames) {
+                int width, height, nrChannels;
+                unsigned char *data = stbi_load(FileSystem::getPath(textureFilename).c_str(), &width, &height, &nrChannels, STBI_rgb_alpha);
+                if(!data) {
+                        std::cout << "Failed to load texture " << textureFilename << std::endl;
+                        width = height = 0;
+                }
+                pagesData.push_back(data);
+                pagesWidth.push_back(width);
+                pagesHeight.push_back(height);
+                maxWidth = std::max(maxWidth, width);
+                maxHeight = std::max(maxHeight, height);
+        }
+
+        glGenTextures(1, &textureId);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, textureId);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-        if(data)
+        if((maxWidth > 0) && (maxHeight > 0))
         {
-                // Remove the chroma key color (##ff00ffff) of the texture atlas
-                for(int i=0; i < width*height*sizeof(GL_RGBA); i+=sizeof(GL_RGBA)) {
-                        if((data[i] == 255) && (data[i+1] == 0) && (data[i+2] == 255) && (data[i+3] == 255)) {
-                                data[i] = data[i+1] = data[i+2] = data[i+3] = 0;
+                // All the pages of the texture array have the size of the biggest page. Smaller pages are stored at the top left corner of their layer.
+                uint16_t totalPages = textureFilenames.size();
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+                glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R8, maxWidth, maxHeight, totalPages, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+
+                // Convert every page to 8-bit palette indexes. All the pages share the same palettes. Index 0 is the transparent color (chroma key ##ff00ffff).
+                uint16_t paletteRows = maxPaletteId + 1;
+                std::vector<unsigned char> palettes(paletteRows * MAX_PALETTE_COLORS * 4, 0);
+                std::vector<unsigned char*> pagesIndexedData;
+                std::map<uint32_t, uint8_t> colorIndexes;
+                uint16_t totalColors = 1; // Index 0 is reserved to the transparent color
+
+                for(uint16_t page=0; page<totalPages; page++) {
+                        unsigned char *indexedData = new unsigned char[pagesWidth[page] * pagesHeight[page]];
+                        if(pagesData[page]) {
+                                totalColors = BuildIndexedTexture(pagesData[page], pagesWidth[page], pagesHeight[page], indexedData, palettes.data(), colorIndexes, totalColors);
                         }
+                        pagesIndexedData.push_back(indexedData);
+
+                        // UVs in objtypes.dat are relative to their own page, the vertex shader scales them to the size of the texture array
+                        atlasPageScales.push_back(float(pagesWidth[page]) / maxWidth);
+                        atlasPageScales.push_back(float(pagesHeight[page]) / maxHeight);
                 }
 
-                // Save the texture atlas in the vram
-                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-                glGenerateMipmap(GL_TEXTURE_2D);
+                // Every palette starts as a copy of the atlas palette
+                for(uint16_t p=1; p<paletteRows; p++) {
+                        std::memcpy(palettes.data() + p*MAX_PALETTE_COLORS*4, palettes.data(), MAX_PALETTE_COLORS*4);
+                }
+
+                for(uint16_t page=0; page<totalPages; page++) {
+                        if(pagesData[page]) {
+                                BuildPaletteSwaps(page, pagesData[page], pagesIndexedData[page], pagesWidth[page], pagesHeight[page], palettes.data());
+                                // Save the indexed page in its layer of the texture array
+                                glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, page, pagesWidth[page], pagesHeight[page], 1, GL_RED, GL_UNSIGNED_BYTE, pagesIndexedData[page]);
+                        }
+                        delete[] pagesIndexedData[page];
+                }
+                printf("Texture atlas pages: %d (%dx%d) Colors: %d Palettes: %d\n", totalPages, maxWidth, maxHeight, totalColors, paletteRows);
+
+                // Save the palettes in the vram, one palette per row
+                glGenTextures(1, &paletteTextureId);
+                glBindTexture(GL_TEXTURE_2D, paletteTextureId);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, MAX_PALETTE_COLORS, paletteRows, 0, GL_RGBA, GL_UNSIGNED_BYTE, palettes.data());
         }
         else
         {
                 std::cout << "Failed to load texture" << std::endl;
         }
 
-        stbi_image_free(data);
+        for(auto data : pagesData) {
+                stbi_image_free(data);
+        }
         return textureId;
 }
 
+uint32_t SceneObjectDataManager::GetPaletteTextureId() {
+        return paletteTextureId;
+}
+
+uint16_t SceneObjectDataManager::GetAtlasPagesCount() {
+        return textureFilenames.size();
+}
+
+const float* SceneObjectDataManager::GetAtlasPageScales() {
+        return atlasPageScales.data();
+}
+
+uint16_t SceneObjectDataManager::BuildIndexedTexture(unsigned char *data, int width, int height, unsigned char *indexedData, unsigned char *palette, std::map<uint32_t, uint8_t> &colorIndexes, uint16_t totalColors) {
+        for(int i=0; i < width*height; i++) {
+                unsigned char *texel = data + i*4;
+
+                // Chroma key color and fully transparent texels use the transparent index
+                if(((texel[0] == 255) && (texel[1] == 0) && (texel[2] == 255) && (texel[3] == 255)) || (texel[3] == 0)) {
+                        indexedData[i] = 0;
+                        continue;
+                }
+
+                uint32_t color = (texel[0] << 24) | (texel[1] << 16) | (texel[2] << 8) | texel[3];
+                auto searchIterator = colorIndexes.find(color);
+                if(searchIterator != colorIndexes.end()) {
+                        indexedData[i] = searchIterator->second;
+                } else if(totalColors < MAX_PALETTE_COLORS) {
+                        std::memcpy(palette + totalColors*4, texel, 4);
+                        colorIndexes[color] = totalColors;
+                        indexedData[i] = totalColors++;
+                } else {
+                        // Palette is full, use the closest color already in the palette
+                        uint8_t closestIndex = 1;
+                        int closestDistance = INT_MAX;
+                        for(uint16_t c=1; c<totalColors; c++) {
+                                int distance = 0;
+                                for(uint8_t k=0; k<4; k++) {
+                                        int d = int(texel[k]) - int(palette[c*4 + k]);
+                                        distance += d*d;
+                                }
+                                if(distance < closestDistance) {
+                                        closestDistance = distance;
+                                        closestIndex = c;
+                                }
+                        }
+                        colorIndexes[color] = closestIndex;
+                        indexedData[i] = closestIndex;
+                }
+        }
+
+        return totalColors;
+}
+
+void SceneObjectDataManager::BuildPaletteSwaps(uint16_t page, unsigned char *data, unsigned char *indexedData, int width, int height, unsigned char *palettes) {
+        // Each texel of the recoloured artwork gives the new color of the palette index found in the base artwork
+        for(auto& paletteSwap : paletteSwaps) {
+                if(paletteSwap.page != page) continue;
+
+                unsigned char *palette = palettes + paletteSwap.id*MAX_PALETTE_COLORS*4;
+                int x1 = std::lround(paletteSwap.u1 * width), y1 = std::lround(paletteSwap.v1 * height);
+                int x2 = std::lround(paletteSwap.u2 * width), y2 = std::lround(paletteSwap.v2 * height);
+                int baseX = std::lround(paletteSwap.baseU * width), baseY = std::lround(paletteSwap.baseV * height);
+
+                for(int y=y1; y<y2; y++) {
+                        for(int x=x1; x<x2; x++) {
+                                int bx = baseX + (x - x1), by = baseY + (y - y1);
+                                if((x >= width) || (y >= height) || (bx >= width) || (by >= height)) continue;
+
+                                uint8_t index = indexedData[by*width + bx];
+                                if(index == 0) continue;
+                                std::memcpy(palette + index*4, data + (y*width + x)*4, 4);
+                        }
+                }
+        }
+}
+
 ObjectSpriteSheet* SceneObjectDataManager::GetSpriteSheetBySceneObjectIdentificator(SceneObjectIdentificator sceneObjectIdentificator) {
         auto searchIterator = objectSpriteSheetsMap.find(sceneObjectIdentificator);
         if (searchIterator != objectSpriteSheetsMap.end()) {
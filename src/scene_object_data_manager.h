@@ -4,27 +4,47 @@
 #include <iostream>
 #include <string>
 #include <map>
+#include <vector>
 #include <object_sprite_sheet.h>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <filesystem.h>
 
 #define OBJECT_TYPES_FILENAME "objtypes.dat"
+#define MAX_PALETTE_COLORS 256
+#define MAX_ATLAS_PAGES 16
 
 using namespace std;
 
+// A palette swap is defined by a recoloured copy (u1, v1, u2, v2) of the base artwork located at (baseU, baseV)
+struct PaletteSwapData { uint16_t id; uint16_t page; float u1, v1, u2, v2, baseU, baseV; };
+
+// UVs of a frame packed in the texture atlas by the atlas_packer tool
+struct AtlasFrameData { uint16_t page; float u1, v1, u2, v2; };
+
 class SceneObjectDataManager
 {
   typedef map<SceneObjectIdentificator, ObjectSpriteSheet*> SpriteSheetsMap;
   SpriteSheetsMap objectSpriteSheetsMap;
-  std::string textureFilename;
+  std::vector<std::string> textureFilenames; // One texture atlas page per '###' line
   uint32_t textureId;
+  std::vector<float> atlasPageScales;
+  uint32_t paletteTextureId = 0;
+  uint16_t maxPaletteId = 0;
+  std::vector<PaletteSwapData> paletteSwaps;
+  std::map<std::string, AtlasFrameData> atlasFrames;
   void LoadObjectsDataFromFile(std::string filename);
+  void LoadSpriteTableFromFile(std::string filename, uint16_t page);
+  uint16_t BuildIndexedTexture(unsigned char*, int, int, unsigned char*, unsigned char*, std::map<uint32_t, uint8_t>&, uint16_t);
+  void BuildPaletteSwaps(uint16_t, unsigned char*, unsigned char*, int, int, unsigned char*);
   void Print();
 public:
   SceneObjectDataManager();
   ~SceneObjectDataManager();
   uint32_t LoadObjectsTextures();
+  uint32_t GetPaletteTextureId();
+  uint16_t GetAtlasPagesCount();
+  const float* GetAtlasPageScales();
   ObjectSpriteSheet* GetSpriteSheetBySceneObjectIdentificator(SceneObjectIdentificator);
 };
 
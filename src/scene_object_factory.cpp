@@ -2,9 +2,9 @@
 #include "object_sprite_sheet.h"
 #include <map>
 
-SceneObjectFactory::SceneObjectFactory(SceneObjectDataManager* _textureManager, aabb::Tree<ISceneObject*>* _spacePartitionObjectsTree) {
+SceneObjectFactory::SceneObjectFactory(SceneObjectDataManager* _textureManager, CollisionWorld* _collisionWorld) {
 	textureManager = _textureManager;
-	spacePartitionObjectsTree = _spacePartitionObjectsTree;
+	collisionWorld = _collisionWorld;
 	RegisterSceneObjects();
 }
 
@@ -44,21 +44,30 @@ void SceneObjectFactory::Register(const SceneObjectIdentificator sceneObjectId,
 	m_FactoryMap[sceneObjectId] = pfnCreate;
 }
 
-ISceneObject *SceneObjectFactory::CreateSceneObject(const SceneObjectIdentificator sceneObjectId)
+ISceneObject *SceneObjectFactory::CreateSceneObject(const SceneObjectIdentificator sceneObjectId, bool joinCollisionWorld)
 {
 	FactoryMap::iterator it = m_FactoryMap.find(sceneObjectId);
 	if( it != m_FactoryMap.end() ) {
 		ISceneObject *sceneObject = it->second();
 		ObjectSpriteSheet *objectSpriteSheet = textureManager->GetSpriteSheetBySceneObjectIdentificator(sceneObject->Id());
-		sceneObject->SetSpacePartitionObjectsTree(spacePartitionObjectsTree);
+		sceneObject->SetCollisionWorld(joinCollisionWorld ? collisionWorld : nullptr);
 		sceneObject->InitWithSpriteSheet(objectSpriteSheet);
 		return sceneObject;
 	}
 	return NULL;
 }
 
-SceneObjectFactory *SceneObjectFactory::Get(SceneObjectDataManager* _textureManager, aabb::Tree<ISceneObject*>* _spacePartitionObjectsTree)
+// Initializes again an object that left the scene, instead of deleting it and creating a new one of the same kind
+ISceneObject *SceneObjectFactory::RecycleSceneObject(ISceneObject *sceneObject, bool joinCollisionWorld)
 {
-	static SceneObjectFactory instance(_textureManager, _spacePartitionObjectsTree);
+	sceneObject->Reset();
+	sceneObject->SetCollisionWorld(joinCollisionWorld ? collisionWorld : nullptr);
+	sceneObject->InitWithSpriteSheet(textureManager->GetSpriteSheetBySceneObjectIdentificator(sceneObject->Id()));
+	return sceneObject;
+}
+
+SceneObjectFactory *SceneObjectFactory::Get(SceneObjectDataManager* _textureManager, CollisionWorld* _collisionWorld)
+{
+	static SceneObjectFactory instance(_textureManager, _collisionWorld);
 	return &instance;
 }
@@ -2,7 +2,7 @@
 #define SCENE_OBJECT_FACTORY_H
 
 #include <map>
-#include <AABB/AABB.h>
+#include "collision_world.h"
 #include "scene_object.h"
 #include "scene_object_data_manager.h"
 #include "items/main_character.h"
@@ -28,18 +28,21 @@
 class SceneObjectFactory
 {
 private:
-  SceneObjectFactory(SceneObjectDataManager*, aabb::Tree<ISceneObject*>*);
+  SceneObjectFactory(SceneObjectDataManager*, CollisionWorld*);
   SceneObjectFactory &operator=(const SceneObjectFactory &);
   void RegisterSceneObjects();
   typedef map<SceneObjectIdentificator, CreateSceneObjectFn> FactoryMap;
   FactoryMap m_FactoryMap;
   SceneObjectDataManager *textureManager = nullptr;
-  aabb::Tree<ISceneObject*> *spacePartitionObjectsTree = nullptr;
+  CollisionWorld *collisionWorld = nullptr;
 public:
 	~SceneObjectFactory();
-	static SceneObjectFactory *Get(SceneObjectDataManager*, aabb::Tree<ISceneObject*>*);
+	static SceneObjectFactory *Get(SceneObjectDataManager*, CollisionWorld*);
 	void Register(const SceneObjectIdentificator, CreateSceneObjectFn);
-	ISceneObject *CreateSceneObject(const SceneObjectIdentificator);
+	// Objects built off the logic thread are created without the collision world (joinCollisionWorld false), the
+	// logic thread gives it to them with SetCollisionWorld when it adds them to the scene
+	ISceneObject *CreateSceneObject(const SceneObjectIdentificator, bool joinCollisionWorld = true);
+	ISceneObject *RecycleSceneObject(ISceneObject*, bool joinCollisionWorld = true);
 };
 
 #endif
@@ -2,28 +2,39 @@
 #include "scene_object_factory.h"
 #include "scene_object.h"
 
-SceneObjectManager::SceneObjectManager(SceneObjectDataManager* _textureManager, UInt16DoubleBuffer* _verticesDoubleBuffer, FloatDoubleBuffer* _uvsDoubleBuffer, uint32_t _maxObjects) {
+SceneObjectManager::SceneObjectManager(SceneObjectDataManager* _textureManager, UInt16DoubleBuffer* _verticesDoubleBuffer, FloatDoubleBuffer* _uvsDoubleBuffer, UInt16DoubleBuffer* _palettesDoubleBuffer, FrameProfiler* _profiler, uint32_t _maxObjects) {
         textureManager = _textureManager;
         verticesDoubleBuffer = _verticesDoubleBuffer;
         uvsDoubleBuffer = _uvsDoubleBuffer;
+        palettesDoubleBuffer = _palettesDoubleBuffer;
+        profiler = _profiler;
         maxObjects = _maxObjects;
-        spacePartitionObjectsTree = new aabb::Tree<ISceneObject*>();
-        spacePartitionObjectsTree->setDimension(2);
         currentEscalatedHeight = 0; // height climbed
         cameraIsMoving = false;
         currentRow = 0;
         visibleRows = 56;
 
+        // Without a level there is no world to build, main checks IsLevelLoaded before running the game
+        if(!levelMap.Open(FileSystem::getPath(LEVEL_FILENAME))) return;
+        levelMap.KeepRows(currentRow, currentRow + visibleRows + levelRowOffset - 1);
+        collisionWorld = new CollisionWorld(cell_w, cell_h, levelMap.Width(), visibleRows + levelRowOffset);
+        kinematicBodies = new KinematicBodySystem(collisionWorld);
+
         BuildWorld();
+
+        // The rows of the first scroll are built ahead of time, and the rows of every scroll while it runs
+        rowPrefetcher = new RowPrefetcher(textureManager, collisionWorld, &levelMap, cell_w, cell_h);
+        rowPrefetcher->Request(currentRow + visibleRows, levelRowOffset, visibleRows);
 }
 
 void SceneObjectManager::BuildWorld() {
+  std::vector<ISceneObject*> worldObjects;
   for(uint16_t row=0; row<visibleRows; row++) {
-    uint16_t y = (map_viewport_height - 1) - row - currentRow;
+    const uint16_t *levelRow = levelMap.Row(row + currentRow);
     std::vector<ISceneObject*> rowObjects;
-    for(uint16_t x=0;x<map_viewport_width;x++) {
-      if(SceneObjectIdentificator obj_id = (SceneObjectIdentificator)worldMap[y][x]) {
-        if(ISceneObject *objectPtr = SceneObjectFactory::Get(textureManager, spacePartitionObjectsTree)->CreateSceneObject(obj_id)) {
+    for(uint16_t x=0;levelRow && (x<levelMap.Width());x++) {
+      if(SceneObjectIdentificator obj_id = (SceneObjectIdentificator)levelRow[x]) {
+        if(ISceneObject *objectPtr = SceneObjectFactory::Get(textureManager, collisionWorld)->CreateSceneObject(obj_id)) {
 
           // Set the initial position of the object in the screen
           objectPtr->position.setX(int16_t(x*cell_w));
@@ -32,25 +43,40 @@ void SceneObjectManager::BuildWorld() {
 
           // Initial update to load the sprites and boundary box
           objectPtr->Update();
-
-          // Insert the object into the space partition tree used for object collision detection
-          spacePartitionObjectsTree->insertParticle(objectPtr, objectPtr->GetLowerBound(), objectPtr->GetUpperBound());
+          worldObjects.push_back(objectPtr);
 
           // Save pointers to proper arrays for static objects and mobile objects
           if(objectPtr->Type() == SceneObjectType::TERRAIN) staticObjects[objectPtr->uniqueId] = objectPtr;
-          else mobileObjects[objectPtr->uniqueId] = objectPtr;
+          else {
+            mobileObjects[objectPtr->uniqueId] = objectPtr;
+            kinematicBodies->AddBody(objectPtr);
+          }
         }
       }
     }
     rowsBuffer.push_back(rowObjects);
   }
+
+  // Bulk insert all the objects into the broad phase used for object collision detection
+  collisionWorld->AddObjects(worldObjects);
 }
 
 void SceneObjectManager::Update(uint8_t pressedKeys) {
+  profiler->BeginCpuStage();
   updateMobileObjects(pressedKeys);
+  profiler->EndCpuStage(CPU_UPDATE_MOBILE);
+
+  profiler->BeginCpuStage();
   updateStaticObjects();
+  profiler->EndCpuStage(CPU_UPDATE_STATIC);
+
+  profiler->BeginCpuStage();
   updateVerticalScroll(pressedKeys);
+  profiler->EndCpuStage(CPU_SCROLL);
+
+  profiler->BeginCpuStage();
   updateVerticesAndUVSBuffers();
+  profiler->EndCpuStage(CPU_EMIT);
 }
 
 void SceneObjectManager::updateVerticesBufferAtIndex(uint16_t index, ISceneObject *objectPtr) {
@@ -79,29 +105,44 @@ void SceneObjectManager::updateVerticesBufferAtIndex(uint16_t index, ISceneObjec
 }
 
 void SceneObjectManager::updateUVSBufferAtIndex(uint16_t index, ISceneObject *objectPtr) {
+  // Each vertex has the texture coordinates (u, v) and the atlas page where the sprite is located
+
   // top right
-  uvsDoubleBuffer->producer_buffer[index * 12] = objectPtr->currentSprite.u2;
-  uvsDoubleBuffer->producer_buffer[index * 12 + 1] = objectPtr->currentSprite.v2;
+  uvsDoubleBuffer->producer_buffer[index * 18] = objectPtr->currentSprite.u2;
+  uvsDoubleBuffer->producer_buffer[index * 18 + 1] = objectPtr->currentSprite.v2;
+  uvsDoubleBuffer->producer_buffer[index * 18 + 2] = objectPtr->currentSprite.atlasPage;
 
   // bottom right
-  uvsDoubleBuffer->producer_buffer[index * 12 + 2] = objectPtr->currentSprite.u2;
-  uvsDoubleBuffer->producer_buffer[index * 12 + 3] = objectPtr->currentSprite.v1;
+  uvsDoubleBuffer->producer_buffer[index * 18 + 3] = objectPtr->currentSprite.u2;
+  uvsDoubleBuffer->producer_buffer[index * 18 + 4] = objectPtr->currentSprite.v1;
+  uvsDoubleBuffer->producer_buffer[index * 18 + 5] = objectPtr->currentSprite.atlasPage;
 
   // top left
-  uvsDoubleBuffer->producer_buffer[index * 12 + 4] = objectPtr->currentSprite.u1;
-  uvsDoubleBuffer->producer_buffer[index * 12 + 5] = objectPtr->currentSprite.v2;
+  uvsDoubleBuffer->producer_buffer[index * 18 + 6] = objectPtr->currentSprite.u1;
+  uvsDoubleBuffer->producer_buffer[index * 18 + 7] = objectPtr->currentSprite.v2;
+  uvsDoubleBuffer->producer_buffer[index * 18 + 8] = objectPtr->currentSprite.atlasPage;
 
   // bottom right
-  uvsDoubleBuffer->producer_buffer[index * 12 + 6] = objectPtr->currentSprite.u2;
-  uvsDoubleBuffer->producer_buffer[index * 12 + 7] = objectPtr->currentSprite.v1;
+  uvsDoubleBuffer->producer_buffer[index * 18 + 9] = objectPtr->currentSprite.u2;
+  uvsDoubleBuffer->producer_buffer[index * 18 + 10] = objectPtr->currentSprite.v1;
+  uvsDoubleBuffer->producer_buffer[index * 18 + 11] = objectPtr->currentSprite.atlasPage;
 
   // bottom left
-  uvsDoubleBuffer->producer_buffer[index * 12 + 8] = objectPtr->currentSprite.u1;
-  uvsDoubleBuffer->producer_buffer[index * 12 + 9] = objectPtr->currentSprite.v1;
+  uvsDoubleBuffer->producer_buffer[index * 18 + 12] = objectPtr->currentSprite.u1;
+  uvsDoubleBuffer->producer_buffer[index * 18 + 13] = objectPtr->currentSprite.v1;
+  uvsDoubleBuffer->producer_buffer[index * 18 + 14] = objectPtr->currentSprite.atlasPage;
 
   // top left
-  uvsDoubleBuffer->producer_buffer[index * 12 + 10] = objectPtr->currentSprite.u1;
-  uvsDoubleBuffer->producer_buffer[index * 12 + 11] = objectPtr->currentSprite.v2;
+  uvsDoubleBuffer->producer_buffer[index * 18 + 15] = objectPtr->currentSprite.u1;
+  uvsDoubleBuffer->producer_buffer[index * 18 + 16] = objectPtr->currentSprite.v2;
+  uvsDoubleBuffer->producer_buffer[index * 18 + 17] = objectPtr->currentSprite.atlasPage;
+}
+
+void SceneObjectManager::updatePalettesBufferAtIndex(uint16_t index, ISceneObject *objectPtr) {
+  // All six vertices of the object quad share the same palette
+  for(uint16_t v=0; v<6; v++) {
+    palettesDoubleBuffer->producer_buffer[index * 6 + v] = objectPtr->currentSprite.paletteId;
+  }
 }
 
 void SceneObjectManager::updateVerticesAndUVSBuffers() {
@@ -110,6 +151,7 @@ void SceneObjectManager::updateVerticesAndUVSBuffers() {
     ISceneObject* objectPtr = x.second;
     updateVerticesBufferAtIndex(i, objectPtr);
     updateUVSBufferAtIndex(i, objectPtr);
+    updatePalettesBufferAtIndex(i, objectPtr);
     i++;
   }
 
@@ -117,21 +159,32 @@ void SceneObjectManager::updateVerticesAndUVSBuffers() {
     ISceneObject* objectPtr = x.second;
     updateVerticesBufferAtIndex(i, objectPtr);
     updateUVSBufferAtIndex(i, objectPtr);
+    updatePalettesBufferAtIndex(i, objectPtr);
     i++;
   }
 
   // Clean unused buffer area
   verticesDoubleBuffer->cleanDataFromPosition(i*12);
-  uvsDoubleBuffer->cleanDataFromPosition(i*12);
+  uvsDoubleBuffer->cleanDataFromPosition(i*18);
+  palettesDoubleBuffer->cleanDataFromPosition(i*6);
 
   verticesDoubleBuffer->swapBuffers();
   uvsDoubleBuffer->swapBuffers();
+  palettesDoubleBuffer->swapBuffers();
 }
 
 void SceneObjectManager::updateMobileObjects(uint8_t pressedKeys) {
   for (auto const& x : mobileObjects) {
     ISceneObject* objectPtr = x.second;
     objectPtr->Update(pressedKeys);
+    collisionWorld->UpdateObject(objectPtr);
+  }
+
+  // Collisions of all the mobile objects are resolved at once, after every one of them has moved
+  kinematicBodies->Update();
+
+  for (auto const& x : mobileObjects) {
+    collisionWorld->DispatchTriggers(x.second);
   }
 }
 
@@ -150,6 +203,13 @@ void SceneObjectManager::updateVerticalScroll(uint8_t pressedKeys) {
       pixelDisplacement = levelRowOffset*cell_h - totalPixelDisplacement;
       cameraIsMoving = false;
 
+      // Remove the bottom hidden rows from the broad phase at once
+      std::vector<ISceneObject*> droppedObjects;
+      for(int r=0; r<levelRowOffset && r<rowsBuffer.size(); r++) {
+        droppedObjects.insert(droppedObjects.end(), rowsBuffer[r].begin(), rowsBuffer[r].end());
+      }
+      collisionWorld->RemoveObjects(droppedObjects);
+
       // Remove bottom hidden rows
       for(int r=0; r<levelRowOffset && r<rowsBuffer.size(); r++) {
         auto objects = rowsBuffer.front();
@@ -157,27 +217,30 @@ void SceneObjectManager::updateVerticalScroll(uint8_t pressedKeys) {
               // Remove the object refefence from all data structures
               ISceneObject *objectPtr = objects[o];
 
-              // Remove the object from the spacet partitioning tree
-              spacePartitionObjectsTree->removeParticle(objectPtr);
-
               if(objectPtr->Type() == SceneObjectType::TERRAIN) {
                 staticObjects.erase(objectPtr->uniqueId);
               } else {
                 mobileObjects.erase(objectPtr->uniqueId);
+                kinematicBodies->RemoveBody(objectPtr);
               }
-
-              delete objectPtr;
         }
         rowsBuffer.pop_front();
       }
+
+      // The dropped objects are reused for the rows of the next scrolls
+      rowPrefetcher->Recycle(droppedObjects);
     }
 
     for(int r=0; r<rowsBuffer.size(); r++) {
       auto objects = rowsBuffer[r];
       for(int o=0; o<objects.size(); o++) {
         objects[o]->PositionAddY(-pixelDisplacement);
+
+        // Terrain is stored in level coordinates in the broad phase and doesn't need any update
+        if(objects[o]->Type() != SceneObjectType::TERRAIN) collisionWorld->UpdateObject(objects[o]);
       }
     }
+    collisionWorld->Scroll(pixelDisplacement);
     totalPixelDisplacement+=pixelDisplacement;
   }
 
@@ -185,30 +248,39 @@ void SceneObjectManager::updateVerticalScroll(uint8_t pressedKeys) {
     if(!cameraIsMoving) {
       cameraIsMoving = true;
       totalPixelDisplacement = 0.0f;
-      for(uint16_t row=0; row<levelRowOffset; row++) {
-        uint16_t y = (map_viewport_height - 1) - row - currentRow - visibleRows;
-        std::vector<ISceneObject*> rowObjects;
-        for(uint16_t x=0;x<map_viewport_width;x++) {
-          if(SceneObjectIdentificator obj_id = (SceneObjectIdentificator)worldMap[y][x]) {
-            if(ISceneObject *objectPtr = SceneObjectFactory::Get(textureManager, spacePartitionObjectsTree)->CreateSceneObject(obj_id)) {
-              objectPtr->position.setX(int16_t(x*cell_w));
-              objectPtr->position.setY(int16_t((visibleRows+row)*cell_h));
-              rowObjects.push_back(objectPtr);
-
-              if(objectPtr->Type() == SceneObjectType::TERRAIN) staticObjects[objectPtr->uniqueId] = objectPtr;
-              else mobileObjects[objectPtr->uniqueId] = objectPtr;
-            }
+      // The rows were built in the background during the previous scroll, only their objects need to be registered.
+      // They were built without the collision world, they get it here on the logic thread.
+      RowBand band;
+      rowPrefetcher->Take(band);
+      for(auto & rowObjects : band.rows) {
+        for(auto objectPtr : rowObjects) {
+          objectPtr->SetCollisionWorld(collisionWorld);
+          if(objectPtr->Type() == SceneObjectType::TERRAIN) staticObjects[objectPtr->uniqueId] = objectPtr;
+          else {
+            mobileObjects[objectPtr->uniqueId] = objectPtr;
+            kinematicBodies->AddBody(objectPtr);
           }
         }
-        rowsBuffer.push_back(rowObjects);
+        rowsBuffer.push_back(std::move(rowObjects));
       }
+      collisionWorld->AddObjects(band.objects);
       currentRow+=levelRowOffset;
+
+      // Rows below the camera won't be read again, the next band of rows is requested in advance
+      levelMap.KeepRows(currentRow, currentRow + visibleRows + levelRowOffset - 1);
+      rowPrefetcher->Request(currentRow + visibleRows, levelRowOffset, visibleRows);
     }
   }
 }
 
 SceneObjectManager::~SceneObjectManager() {
-  if(spacePartitionObjectsTree != nullptr) {
-    delete spacePartitionObjectsTree;
+  if(rowPrefetcher != nullptr) {
+    delete rowPrefetcher;
+  }
+  if(kinematicBodies != nullptr) {
+    delete kinematicBodies;
+  }
+  if(collisionWorld != nullptr) {
+    delete collisionWorld;
   }
 }
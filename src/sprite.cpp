@@ -8,6 +8,8 @@ Sprite::Sprite() {
         v1 = 0.0f;
         u2 = 0.5f;
         v2 = 0.5f;
+        paletteId = 0;
+        atlasPage = 0;
 }
 
 Sprite::~Sprite() {
@@ -7,8 +7,16 @@
 
 using namespace std;
 
-struct Area { uint16_t id; collision::Rectangle rectangle; };
-struct SpriteAreas { std::vector<Area> solidAreas; std::vector<Area> simpleAreas; };
+// Collision categories of the areas. Solid areas are SOLID and only meet other solid areas, in the solid collision
+// pass. A simple area whose mask is not empty is a trigger: the trigger pass reports every area of another object
+// whose category is in its mask.
+enum CollisionCategory: uint16_t { COLLISION_CATEGORY_SOLID = 0x0001, COLLISION_CATEGORY_BODY = 0x0002, COLLISION_CATEGORY_HAMMER = 0x0004, COLLISION_CATEGORY_PICKUP = 0x0008 };
+
+struct Area { uint16_t id; collision::Box2 box; uint16_t category; uint16_t mask; };
+
+// categories and triggerMask join the categories of every area and the masks of the simple areas, so the trigger
+// pass rejects objects without looking at their areas
+struct SpriteAreas { std::vector<Area> solidAreas; std::vector<Area> simpleAreas; uint16_t categories = 0; uint16_t triggerMask = 0; };
 
 class Sprite
 {
@@ -19,6 +27,8 @@ class Sprite
   int16_t xOffset;
   int16_t yOffset;
   float u1, v1, u2, v2;
+  uint16_t paletteId;
+  uint16_t atlasPage;
   SpriteAreas *areas;
   Sprite();
   ~Sprite();
@@ -372,6 +372,21 @@ namespace aabb
          */
         void insertParticle(T, std::vector<double>&, std::vector<double>&);
 
+        //! Insert a particle into the tree without registering it in particleMap.
+        /*! \param index
+                The index of the particle.
+
+            \param lowerBound
+                The lower bound in each dimension.
+
+            \param upperBound
+                The upper bound in each dimension.
+
+            \return
+                The node of the particle, used as handle by removeParticleNode and updateParticleNode.
+         */
+        unsigned int insertParticleNode(T, const std::vector<double>&, const std::vector<double>&);
+
         /// Return the number of particles in the tree.
         unsigned int nParticles();
 
@@ -381,6 +396,12 @@ namespace aabb
          */
         void removeParticle(T);
 
+        //! Remove a particle from the tree by its node handle.
+        /*! \param node
+                The node returned by insertParticleNode.
+         */
+        void removeParticleNode(unsigned int);
+
         /// Remove all particles from the tree.
         void removeAll();
 
@@ -417,6 +438,24 @@ namespace aabb
          */
         bool updateParticle(T, std::vector<double>&, std::vector<double>&, bool alwaysReinsert=false);
 
+        //! Update the tree if a particle moves outside its fattened AABB, by its node handle.
+        /*! \param node
+                The node returned by insertParticleNode.
+
+            \param lowerBound
+                The lower bound in each dimension.
+
+            \param upperBound
+                The upper bound in each dimension.
+
+            \param alwaysReinsert
+                Always reinsert the particle, even if it's within its old AABB (default: false)
+
+            \return
+                Whether the particle was reinserted.
+         */
+        bool updateParticleNode(unsigned int, const std::vector<double>&, const std::vector<double>&, bool alwaysReinsert=false);
+
         //! Query the tree to find candidate interactions for a particle.
         /*! \param particle
                 The particle index.
@@ -459,6 +498,22 @@ namespace aabb
          */
         std::vector<T> query(const AABB&);
 
+        //! Visit the particles whose AABB overlaps an AABB, without allocating.
+        /*! \param aabb
+                The AABB.
+
+            \param visitor
+                Callable taking a particle and returning false to stop the query.
+
+            \param stack
+                Scratch buffer for the traversal, reused between calls.
+
+            \return
+                Whether all the candidates were visited.
+         */
+        template <class Fn>
+        bool queryVisit(const AABB&, Fn&&, std::vector<unsigned int>&);
+
         //! Get a particle AABB.
         /*! \param particle
                 The particle index.
@@ -537,6 +592,9 @@ namespace aabb
         /// A map between particle and node indices.
         std::map<T, unsigned int, ClassComparator<T> > particleMap;
 
+        /// The number of particles in the tree (particles inserted by node are not in particleMap).
+        unsigned int particleCount = 0;
+
         /// Does touching count as overlapping in tree queries?
         bool touchIsOverlap;
 
@@ -877,6 +935,15 @@ namespace aabb
             throw std::invalid_argument("[ERROR]: Particle already exists in tree!");
         }
 
+        unsigned int node = insertParticleNode(particle, lowerBound, upperBound);
+
+        // Add the new particle to the map.
+        particleMap.insert(std::pair<T,int>(particle,node));
+    }
+
+    template <class T>
+    unsigned int Tree<T>::insertParticleNode(T particle, const std::vector<double>& lowerBound, const std::vector<double>& upperBound)
+    {
         // Validate the dimensionality of the bounds vectors.
         if ((lowerBound.size() != dimension) || (upperBound.size() != dimension))
         {
@@ -886,10 +953,7 @@ namespace aabb
         // Allocate a new node for the particle.
         unsigned int node = allocateNode();
 
-        // AABB size in each dimension.
-        std::vector<double> size(dimension);
-
-        // Compute the AABB limits.
+        // Compute the AABB limits and fatten them.
         for (unsigned int i=0;i<dimension;i++)
         {
             // Validate the bound.
@@ -898,16 +962,9 @@ namespace aabb
                 throw std::invalid_argument("[ERROR]: AABB lower bound is greater than the upper bound!");
             }
 
-            nodes[node].aabb.lowerBound[i] = lowerBound[i];
-            nodes[node].aabb.upperBound[i] = upperBound[i];
-            size[i] = upperBound[i] - lowerBound[i];
-        }
-
-        // Fatten the AABB.
-        for (unsigned int i=0;i<dimension;i++)
-        {
-            nodes[node].aabb.lowerBound[i] -= skinThickness * size[i];
-            nodes[node].aabb.upperBound[i] += skinThickness * size[i];
+            double size = upperBound[i] - lowerBound[i];
+            nodes[node].aabb.lowerBound[i] = lowerBound[i] - skinThickness * size;
+            nodes[node].aabb.upperBound[i] = upperBound[i] + skinThickness * size;
         }
         nodes[node].aabb.surfaceArea = nodes[node].aabb.computeSurfaceArea();
         nodes[node].aabb.centre = nodes[node].aabb.computeCentre();
@@ -918,17 +975,17 @@ namespace aabb
         // Insert a new leaf into the tree.
         insertLeaf(node);
 
-        // Add the new particle to the map.
-        particleMap.insert(std::pair<T,int>(particle,node));
-
         // Store the particle index.
         nodes[node].particle = particle;
+        particleCount++;
+
+        return node;
     }
 
     template <class T>
     unsigned int Tree<T>::nParticles()
     {
-        return particleMap.size();
+        return particleCount;
     }
 
     template <class T>
@@ -952,36 +1009,36 @@ namespace aabb
         // Erase the particle from the map.
         particleMap.erase(it);
 
+        removeParticleNode(node);
+    }
+
+    template <class T>
+    void Tree<T>::removeParticleNode(unsigned int node)
+    {
         assert(node < nodeCapacity);
         assert(nodes[node].isLeaf());
 
         removeLeaf(node);
         freeNode(node);
+        particleCount--;
     }
 
     template <class T>
     void Tree<T>::removeAll()
     {
-        // Iterator pointing to the start of the particle map.
-        typename std::map<T, unsigned int>::iterator it = particleMap.begin();
-
-        // Iterate over the map.
-        while (it != particleMap.end())
+        // Leaves keep their node index while other leaves are removed, so every allocated leaf can be freed in place.
+        for (unsigned int node=0;node<nodeCapacity;node++)
         {
-            // Extract the node index.
-            unsigned int node = it->second;
-
-            assert(node < nodeCapacity);
-            assert(nodes[node].isLeaf());
-
-            removeLeaf(node);
-            freeNode(node);
-
-            it++;
+            if (nodes[node].height == 0)
+            {
+                removeLeaf(node);
+                freeNode(node);
+            }
         }
 
         // Clear the particle map.
         particleMap.clear();
+        particleCount = 0;
     }
 
     template <class T>
@@ -1031,49 +1088,46 @@ namespace aabb
             throw std::invalid_argument("[ERROR]: Invalid particle index!");
         }
 
-        // Extract the node index.
-        unsigned int node = it->second;
+        return updateParticleNode(it->second, lowerBound, upperBound, alwaysReinsert);
+    }
 
+    template <class T>
+    bool Tree<T>::updateParticleNode(unsigned int node, const std::vector<double>& lowerBound,
+                              const std::vector<double>& upperBound, bool alwaysReinsert)
+    {
         assert(node < nodeCapacity);
         assert(nodes[node].isLeaf());
 
-        // AABB size in each dimension.
-        std::vector<double> size(dimension);
-
-        // Compute the AABB limits.
+        // Validate the bounds and check whether the particle is still within its fattened AABB.
+        AABB& aabb = nodes[node].aabb;
+        bool contained = true;
         for (unsigned int i=0;i<dimension;i++)
         {
-            // Validate the bound.
             if (lowerBound[i] > upperBound[i])
             {
                 throw std::invalid_argument("[ERROR]: AABB lower bound is greater than the upper bound!");
             }
 
-            size[i] = upperBound[i] - lowerBound[i];
+            if ((lowerBound[i] < aabb.lowerBound[i]) || (upperBound[i] > aabb.upperBound[i])) contained = false;
         }
 
-        // Create the new AABB.
-        AABB aabb(lowerBound, upperBound);
-
         // No need to update if the particle is still within its fattened AABB.
-        if (!alwaysReinsert && nodes[node].aabb.contains(aabb)) return false;
+        if (!alwaysReinsert && contained) return false;
 
         // Remove the current leaf.
         removeLeaf(node);
 
-        // Fatten the new AABB.
+        // Assign the new fattened AABB in place.
         for (unsigned int i=0;i<dimension;i++)
         {
-            aabb.lowerBound[i] -= skinThickness * size[i];
-            aabb.upperBound[i] += skinThickness * size[i];
+            double size = upperBound[i] - lowerBound[i];
+            aabb.lowerBound[i] = lowerBound[i] - skinThickness * size;
+            aabb.upperBound[i] = upperBound[i] + skinThickness * size;
         }
 
-        // Assign the new AABB.
-        nodes[node].aabb = aabb;
-
         // Update the surface area and centroid.
-        nodes[node].aabb.surfaceArea = nodes[node].aabb.computeSurfaceArea();
-        nodes[node].aabb.centre = nodes[node].aabb.computeCentre();
+        aabb.surfaceArea = aabb.computeSurfaceArea();
+        aabb.centre = aabb.computeCentre();
 
         // Insert a new leaf node.
         insertLeaf(node);
@@ -1179,7 +1233,7 @@ namespace aabb
     std::vector<T> Tree<T>::query(const AABB& aabb)
     {
         // Make sure the tree isn't empty.
-        if (particleMap.size() == 0)
+        if (particleCount == 0)
         {
             return std::vector<T>();
         }
@@ -1188,6 +1242,48 @@ namespace aabb
         return query(std::numeric_limits<T>::max(), aabb);
     }
 
+    template <class T>
+    template <class Fn>
+    bool Tree<T>::queryVisit(const AABB& aabb, Fn&& visitor, std::vector<unsigned int>& stack)
+    {
+        // Periodic boxes need shifted copies of the node AABBs, use the allocating query.
+        if (isPeriodic)
+        {
+            for (T particle : query(aabb))
+            {
+                if (!visitor(particle)) return false;
+            }
+            return true;
+        }
+
+        if (root == NULL_NODE) return true;
+
+        stack.clear();
+        stack.push_back(root);
+
+        while (stack.size() > 0)
+        {
+            unsigned int node = stack.back();
+            stack.pop_back();
+
+            // Test for overlap between the AABBs, without copying the node AABB.
+            if (aabb.overlaps(nodes[node].aabb, touchIsOverlap))
+            {
+                if (nodes[node].isLeaf())
+                {
+                    if (!visitor(nodes[node].particle)) return false;
+                }
+                else
+                {
+                    stack.push_back(nodes[node].left);
+                    stack.push_back(nodes[node].right);
+                }
+            }
+        }
+
+        return true;
+    }
+
     template <class T>
     const AABB& Tree<T>::getAABB(T particle)
     {
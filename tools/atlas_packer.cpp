@@ -0,0 +1,232 @@
+// Offline texture atlas packer.
+//
+// Packs every image found in a frames directory into a single texture atlas using a skyline
+// bottom-left packer, and writes the atlas (uncompressed TGA) plus a sprite table with the UV
+// coordinates of every frame. The sprite table is loaded by SceneObjectDataManager through the
+// '@@' line of objtypes.dat, and sprite lines may then use '@<frame name>' instead of hand-typed UVs.
+//
+// Usage: atlas_packer <frames directory> <output atlas .tga> <output sprite table>
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <dirent.h>
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+const uint16_t FRAME_PADDING = 1; // pixels between frames to avoid texel bleeding
+const uint16_t MAX_ATLAS_SIZE = 8192;
+
+struct Frame { std::string name; int width, height; unsigned char *data; int x, y; };
+struct SkylineNode { int x, y, width; };
+
+bool endsWith(const std::string &mainStr, const std::string &toMatch)
+{
+        return (mainStr.size() >= toMatch.size()) && (mainStr.compare(mainStr.size() - toMatch.size(), toMatch.size(), toMatch) == 0);
+}
+
+bool loadFrames(const std::string &directory, std::vector<Frame> &frames)
+{
+        DIR *dir = opendir(directory.c_str());
+        if(dir == nullptr) {
+                std::cout << "Unable to open frames directory " << directory << std::endl;
+                return false;
+        }
+
+        while(struct dirent *entry = readdir(dir)) {
+                std::string filename = entry->d_name;
+                if(!endsWith(filename, ".png") && !endsWith(filename, ".tga")) continue;
+
+                int width, height, nrChannels;
+                unsigned char *data = stbi_load((directory + "/" + filename).c_str(), &width, &height, &nrChannels, STBI_rgb_alpha);
+                if(data == nullptr) {
+                        std::cout << "Failed to load frame " << filename << std::endl;
+                        continue;
+                }
+
+                frames.push_back({ filename.substr(0, filename.size() - 4), width, height, data, 0, 0 });
+        }
+
+        closedir(dir);
+        return !frames.empty();
+}
+
+// Returns the lowest y where a rectangle of the given width fits starting at the skyline node index, or -1
+int skylineFit(const std::vector<SkylineNode> &skyline, size_t index, int width, int height, int atlasWidth, int atlasHeight)
+{
+        int x = skyline[index].x;
+        if(x + width > atlasWidth) return -1;
+
+        int y = skyline[index].y;
+        int widthLeft = width;
+        while(widthLeft > 0) {
+                if(index >= skyline.size()) return -1;
+                y = std::max(y, skyline[index].y);
+                if(y + height > atlasHeight) return -1;
+                widthLeft -= skyline[index].width;
+                index++;
+        }
+        return y;
+}
+
+void skylineInsert(std::vector<SkylineNode> &skyline, size_t index, int x, int y, int width, int height)
+{
+        skyline.insert(skyline.begin() + index, { x, y + height, width });
+
+        // Shrink or remove the nodes now covered by the new one
+        for(size_t i = index + 1; i < skyline.size(); i++) {
+                int previousEnd = skyline[i-1].x + skyline[i-1].width;
+                if(skyline[i].x >= previousEnd) break;
+
+                int shrink = previousEnd - skyline[i].x;
+                skyline[i].x += shrink;
+                skyline[i].width -= shrink;
+                if(skyline[i].width > 0) break;
+                skyline.erase(skyline.begin() + i);
+                i--;
+        }
+
+        // Merge neighbour nodes at the same height
+        for(size_t i = 0; i + 1 < skyline.size(); i++) {
+                if(skyline[i].y == skyline[i+1].y) {
+                        skyline[i].width += skyline[i+1].width;
+                        skyline.erase(skyline.begin() + i + 1);
+                        i--;
+                }
+        }
+}
+
+// Skyline bottom-left packing. Frames must be sorted from the tallest to the shortest one.
+bool packFrames(std::vector<Frame> &frames, int atlasWidth, int atlasHeight)
+{
+        std::vector<SkylineNode> skyline;
+        skyline.push_back({ 0, 0, atlasWidth });
+
+        for(auto &frame : frames) {
+                int width = frame.width + FRAME_PADDING, height = frame.height + FRAME_PADDING;
+                int bestY = INT32_MAX, bestX = 0;
+                size_t bestIndex = 0;
+                bool found = false;
+
+                for(size_t i = 0; i < skyline.size(); i++) {
+                        int y = skylineFit(skyline, i, width, height, atlasWidth, atlasHeight);
+                        if((y >= 0) && (y < bestY)) {
+                                bestY = y;
+                                bestX = skyline[i].x;
+                                bestIndex = i;
+                                found = true;
+                        }
+                }
+
+                if(!found) return false;
+
+                frame.x = bestX;
+                frame.y = bestY;
+                skylineInsert(skyline, bestIndex, bestX, bestY, width, height);
+        }
+
+        return true;
+}
+
+bool writeAtlas(const std::string &filename, const std::vector<Frame> &frames, int atlasWidth, int atlasHeight)
+{
+        std::vector<unsigned char> pixels(atlasWidth * atlasHeight * 4, 0);
+        for(auto &frame : frames) {
+                for(int y = 0; y < frame.height; y++) {
+                        for(int x = 0; x < frame.width; x++) {
+                                const unsigned char *src = frame.data + (y * frame.width + x) * 4;
+                                unsigned char *dst = pixels.data() + ((frame.y + y) * atlasWidth + frame.x + x) * 4;
+                                // TGA stores pixels as BGRA
+                                dst[0] = src[2];
+                                dst[1] = src[1];
+                                dst[2] = src[0];
+                                dst[3] = src[3];
+                        }
+                }
+        }
+
+        std::ofstream outfile(filename, std::ios::binary);
+        if(!outfile) return false;
+
+        // Uncompressed true-color TGA, 32 bits per pixel, top-left origin
+        unsigned char header[18] = { 0 };
+        header[2] = 2;
+        header[12] = atlasWidth & 0xff;
+        header[13] = (atlasWidth >> 8) & 0xff;
+        header[14] = atlasHeight & 0xff;
+        header[15] = (atlasHeight >> 8) & 0xff;
+        header[16] = 32;
+        header[17] = 0x28;
+        outfile.write((const char*)header, sizeof(header));
+        outfile.write((const char*)pixels.data(), pixels.size());
+        return outfile.good();
+}
+
+bool writeSpriteTable(const std::string &filename, std::vector<Frame> frames, int atlasWidth, int atlasHeight)
+{
+        std::ofstream outfile(filename);
+        if(!outfile) return false;
+
+        std::sort(frames.begin(), frames.end(), [](const Frame &a, const Frame &b) { return a.name < b.name; });
+
+        outfile << "// Generated by atlas_packer. Do not edit." << std::endl;
+        outfile << "// name u1 v1 u2 v2 width height" << std::endl;
+        for(auto &frame : frames) {
+                char line[512];
+                snprintf(line, sizeof(line), "%s %.6f %.6f %.6f %.6f %d %d", frame.name.c_str(),
+                         float(frame.x) / atlasWidth, float(frame.y) / atlasHeight,
+                         float(frame.x + frame.width) / atlasWidth, float(frame.y + frame.height) / atlasHeight,
+                         frame.width, frame.height);
+                outfile << line << std::endl;
+        }
+        return outfile.good();
+}
+
+int main(int argc, char *argv[])
+{
+        if(argc != 4) {
+                std::cout << "Usage: " << argv[0] << " <frames directory> <output atlas .tga> <output sprite table>" << std::endl;
+                return 1;
+        }
+
+        std::vector<Frame> frames;
+        if(!loadFrames(argv[1], frames)) {
+                std::cout << "No frames found in " << argv[1] << std::endl;
+                return 1;
+        }
+
+        // Tallest frames first, names break ties so the output is deterministic
+        std::sort(frames.begin(), frames.end(), [](const Frame &a, const Frame &b) {
+                if(a.height != b.height) return a.height > b.height;
+                if(a.width != b.width) return a.width > b.width;
+                return a.name < b.name;
+        });
+
+        // Start from the smallest power of two square that could hold all the frames and grow it until they fit
+        long totalArea = 0;
+        for(auto &frame : frames) totalArea += long(frame.width + FRAME_PADDING) * (frame.height + FRAME_PADDING);
+
+        int atlasWidth = 16, atlasHeight = 16;
+        while(long(atlasWidth) * atlasHeight < totalArea) {
+                if(atlasWidth <= atlasHeight) atlasWidth *= 2; else atlasHeight *= 2;
+        }
+
+        while(!packFrames(frames, atlasWidth, atlasHeight)) {
+                if(atlasWidth <= atlasHeight) atlasWidth *= 2; else atlasHeight *= 2;
+                if((atlasWidth > MAX_ATLAS_SIZE) || (atlasHeight > MAX_ATLAS_SIZE)) {
+                        std::cout << "Frames do not fit in a " << MAX_ATLAS_SIZE << "x" << MAX_ATLAS_SIZE << " atlas" << std::endl;
+                        return 1;
+                }
+        }
+
+        bool success = writeAtlas(argv[2], frames, atlasWidth, atlasHeight) && writeSpriteTable(argv[3], frames, atlasWidth, atlasHeight);
+        printf("Packed %lu frames in a %dx%d atlas (%.1f%% used)\n", frames.size(), atlasWidth, atlasHeight, 100.0 * totalArea / (double(atlasWidth) * atlasHeight));
+
+        for(auto &frame : frames) stbi_image_free(frame.data);
+        return success ? 0 : 1;
+}
@@ -0,0 +1,418 @@
+// Broad phase benchmark suite.
+//
+// Runs every broad phase (the generic dynamic AABB tree aabb::Tree through AABBTreeBroadphase, the 2D AABB tree,
+// the uniform grid and the sort and sweep) on several scenes, numbers of mobile bodies and motion patterns, and
+// prints one machine readable record per run so the numbers can be tracked between revisions.
+//
+// Scenes:
+//   worldmap   the terrain of worldMap, with the bounds of every object read from objtypes.dat
+//   platforms  synthetic level as tall as --rows: side walls and a platform every 6 rows
+//   cluster    the worldmap terrain with the mobile bodies packed in a square of 4x4 cells per 100 bodies
+// Motion patterns:
+//   walk       horizontal back and forth, like the player and the enemies
+//   fall       vertical fall that wraps to the top, like falling bricks and debris
+//   jitter     small random steps in every direction
+//   teleport   random positions every frame, the worst case for incremental structures
+//
+// Measured for every run: insert (one object at a time and row by row with the bulk build, like BuildWorld and the
+// vertical scroll), update and remove throughput in objects per second, the latency of the neighbourhood query of
+// every mobile body as percentiles in nanoseconds, and the bytes of a node of the trees. The sort and sweep also
+// times finding all the overlapping pairs with a single sweep, instead of one query per mobile body.
+//
+// Usage: rocket_bench_broadphase [--csv] [--frames N] [--bodies N] [--rows N] [--objtypes path]
+//   Without --bodies it runs with 100, 1000 and 10000 mobile bodies. Without --frames it runs 10000 / bodies frames,
+//   10 at least. --rows sets the height of the platforms scene (720 rows by default). Prints JSON unless --csv is given.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <cctype>
+#include <world_map.h>
+#include <collision/broadphase/SpatialHashGrid.h>
+#include <collision/broadphase/AABBTreeBroadphase.h>
+#include <collision/broadphase/Tree2D.h>
+#include <collision/broadphase/SweepAndPrune.h>
+
+const uint16_t CELL_SIZE = 16;
+const float BODY_WIDTH = 23, BODY_HEIGHT = 39; // bounding box of the main character
+
+// aabb::Tree compares the objects through their uniqueId
+struct Body { uint32_t uniqueId; collision::Bounds2 bounds; float speedX, speedY; };
+
+struct Scene { std::string name; std::vector<Body> terrain; float width, height; float clusterX, clusterY; bool clustered; };
+
+struct Result {
+        std::string scene, motion, structure;
+        uint32_t terrain, bodies, frames;
+        double insertPerSecond, batchInsertPerSecond, updatePerSecond, removePerSecond;
+        double queryP50, queryP90, queryP99, queryMax;
+        uint64_t candidates;
+        uint32_t nodeBytes; // 0 for the structures without nodes
+        double pairsMicroseconds; // per frame, negative for the structures without a pair sweep
+        uint64_t pairs;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+double elapsedSeconds(Clock::time_point start)
+{
+        return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Bounding box of every object id in objtypes.dat: the bounds of the first sprite of its first animation. Sprite
+// lines follow SceneObjectDataManager: width height xOffset yOffset, the UVs (four values or a single '@<frame name>'
+// from the sprite table), the duration and the four bounds.
+std::map<uint16_t, collision::Bounds2> loadObjectBounds(const char *path)
+{
+        std::map<uint16_t, collision::Bounds2> objectBounds;
+        std::ifstream file(path);
+        std::string line;
+        int32_t objectId = -1;
+        bool spriteFound = false;
+        while (std::getline(file, line)) {
+                std::istringstream tokens(line);
+                std::string token;
+                std::vector<std::string> values;
+                bool spriteLine = true;
+                while ((tokens >> token) && (token.compare(0, 2, "//") != 0)) {
+                        if (token.compare(0, 3, "###") == 0) {
+                                spriteLine = false;
+                        } else if (token.compare(0, 2, "##") == 0) {
+                                objectId = atoi(token.c_str() + 2);
+                                spriteFound = false;
+                                spriteLine = false;
+                        } else if ((token[0] == '#') || (token[0] == '%') || (token[0] == '_') || (token.compare(0, 2, "@@") == 0)) {
+                                spriteLine = false;
+                        }
+                        if (!spriteLine) break;
+                        values.push_back(token);
+                }
+                if (!spriteLine || values.empty() || (objectId < 0) || spriteFound) continue;
+
+                // A first sprite too short to hold the bounds leaves the object without them, as the game drops it
+                spriteFound = true;
+                bool uvsFromSpriteTable = (values.size() > 4) && (values[4][0] == '@');
+                size_t c = uvsFromSpriteTable ? 5 : 8; // index of the duration, the first value after the UVs
+                if (values.size() < c + 5) continue;
+                objectBounds[objectId] = { strtof(values[c + 1].c_str(), nullptr), strtof(values[c + 2].c_str(), nullptr),
+                                           strtof(values[c + 3].c_str(), nullptr), strtof(values[c + 4].c_str(), nullptr) };
+        }
+        return objectBounds;
+}
+
+// Terrain of worldMap in level coordinates (y grows upwards from the bottom row)
+Scene worldMapScene(const std::map<uint16_t, collision::Bounds2> &objectBounds)
+{
+        Scene scene = { "worldmap", {}, float(WORLD_MAP_WIDTH * CELL_SIZE), float(WORLD_MAP_HEIGHT * CELL_SIZE), 0, 0, false };
+        uint32_t id = 1;
+        std::set<uint16_t> missingIds;
+        for (uint16_t y = 0; y < WORLD_MAP_HEIGHT; y++) {
+                for (uint16_t x = 0; x < WORLD_MAP_WIDTH; x++) {
+                        uint16_t objectId = worldMap[y][x];
+                        if ((objectId == 0) || (objectId == 1)) continue; // empty cell or the main character
+
+                        collision::Bounds2 box = { 0, 0, CELL_SIZE, CELL_SIZE };
+                        auto it = objectBounds.find(objectId);
+                        if (it != objectBounds.end()) box = it->second;
+                        else missingIds.insert(objectId);
+                        float cellX = x * CELL_SIZE, cellY = (WORLD_MAP_HEIGHT - 1 - y) * CELL_SIZE;
+                        scene.terrain.push_back({ id++, { cellX + box.lowerX, cellY + box.lowerY, cellX + box.upperX, cellY + box.upperY }, 0, 0 });
+                }
+        }
+        if (!objectBounds.empty()) {
+                for (uint16_t objectId : missingIds) fprintf(stderr, "Object %u has no sprite bounds in objtypes.dat, it takes a whole cell\n", objectId);
+        }
+        return scene;
+}
+
+Scene platformsScene(uint32_t rows, std::mt19937 &generator)
+{
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        Scene scene = { "platforms", {}, float(WORLD_MAP_WIDTH * CELL_SIZE), float(rows * CELL_SIZE), 0, 0, false };
+        uint32_t id = 1;
+        for (uint32_t y = 0; y < rows; y++) {
+                for (uint32_t x = 0; x < WORLD_MAP_WIDTH; x++) {
+                        bool wall = (x < 2) || (x >= WORLD_MAP_WIDTH - 2);
+                        bool platform = (y % 6 == 0) && (unit(generator) < 0.7f);
+                        if (!wall && !platform) continue;
+                        float lowerX = x * CELL_SIZE, lowerY = y * CELL_SIZE;
+                        scene.terrain.push_back({ id++, { lowerX, lowerY, lowerX + CELL_SIZE - 1, lowerY + CELL_SIZE - 1 }, 0, 0 });
+                }
+        }
+        return scene;
+}
+
+std::vector<Body> spawnBodies(const Scene &scene, const std::string &motion, uint32_t count, std::mt19937 &generator)
+{
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        std::vector<Body> bodies;
+        uint32_t id = 1000000;
+
+        // 4x4 cells for every 100 bodies, as wide as the space between the side walls at most
+        float clusterSide = std::min(scene.width - 4 * CELL_SIZE - BODY_WIDTH, 4 * CELL_SIZE * std::sqrt(count / 100.0f));
+        for (uint32_t i = 0; i < count; i++) {
+                float x, y;
+                if (scene.clustered) {
+                        x = scene.clusterX - clusterSide * 0.5f + unit(generator) * clusterSide;
+                        y = scene.clusterY + unit(generator) * clusterSide;
+                } else {
+                        x = 2 * CELL_SIZE + unit(generator) * (scene.width - 4 * CELL_SIZE - BODY_WIDTH);
+                        y = unit(generator) * (scene.height - BODY_HEIGHT);
+                }
+                float speedX = 0, speedY = 0;
+                if (motion == "walk") speedX = (unit(generator) < 0.5f) ? -2.0f : 2.0f;
+                else if (motion == "fall") speedY = -(1.0f + unit(generator) * 3.0f);
+                bodies.push_back({ id++, { x, y, x + BODY_WIDTH, y + BODY_HEIGHT }, speedX, speedY });
+        }
+        return bodies;
+}
+
+void moveBody(Body &body, const Scene &scene, const std::string &motion, std::mt19937 &generator)
+{
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        float dx = body.speedX, dy = body.speedY;
+        if (motion == "jitter") {
+                dx = unit(generator) * 2.0f - 1.0f;
+                dy = unit(generator) * 2.0f - 1.0f;
+        } else if (motion == "teleport") {
+                dx = 2 * CELL_SIZE + unit(generator) * (scene.width - 4 * CELL_SIZE - BODY_WIDTH) - body.bounds.lowerX;
+                dy = unit(generator) * (scene.height - BODY_HEIGHT) - body.bounds.lowerY;
+        }
+        body.bounds = { body.bounds.lowerX + dx, body.bounds.lowerY + dy, body.bounds.upperX + dx, body.bounds.upperY + dy };
+
+        // Walkers turn at the side walls, falling bodies wrap to the top of the scene
+        if ((body.bounds.lowerX < 2 * CELL_SIZE) || (body.bounds.upperX > scene.width - 2 * CELL_SIZE)) body.speedX = -body.speedX;
+        if (body.bounds.upperY < 0) {
+                body.bounds.lowerY += scene.height;
+                body.bounds.upperY += scene.height;
+        }
+}
+
+double percentile(std::vector<double> &sorted, double p)
+{
+        if (sorted.empty()) return 0.0;
+        size_t index = std::min(sorted.size() - 1, size_t(p * (sorted.size() - 1) + 0.5));
+        return sorted[index];
+}
+
+// Inserts the terrain row by row with the bulk build, like BuildWorld and the vertical scroll, then the bodies in a
+// single batch whose handles are returned
+std::vector<collision::BroadphaseHandle> insertRows(collision::Broadphase<Body*> &broadphase, std::vector<Body> &terrain, std::vector<Body> &bodies)
+{
+        std::vector<Body*> rowObjects;
+        std::vector<collision::Bounds2> rowBounds;
+        std::vector<collision::BroadphaseHandle> rowHandles;
+        for (size_t i = 0; i < terrain.size(); i++) {
+                rowObjects.push_back(&terrain[i]);
+                rowBounds.push_back(terrain[i].bounds);
+                bool rowEnds = (i + 1 == terrain.size()) || (int32_t(terrain[i + 1].bounds.lowerY) / CELL_SIZE != int32_t(terrain[i].bounds.lowerY) / CELL_SIZE);
+                if (rowEnds) {
+                        rowHandles.resize(rowObjects.size());
+                        broadphase.insertBatch(rowObjects.data(), rowBounds.data(), rowObjects.size(), rowHandles.data());
+                        rowObjects.clear();
+                        rowBounds.clear();
+                }
+        }
+        for (Body &body : bodies) {
+                rowObjects.push_back(&body);
+                rowBounds.push_back(body.bounds);
+        }
+        std::vector<collision::BroadphaseHandle> handles(bodies.size());
+        broadphase.insertBatch(rowObjects.data(), rowBounds.data(), rowObjects.size(), handles.data());
+        return handles;
+}
+
+// All the overlapping pairs at once with a single sweep, only the sort and sweep can find them this way
+template <class B>
+void runPairs(B &, uint32_t, Result &)
+{
+}
+
+void runPairs(collision::SweepAndPrune<Body*> &sweepAndPrune, uint32_t frames, Result &result)
+{
+        uint64_t pairs = 0;
+        Clock::time_point start = Clock::now();
+        for (uint32_t frame = 0; frame < frames; frame++) {
+                sweepAndPrune.visitPairs([&pairs](Body*, Body*) { pairs++; return true; });
+        }
+        result.pairsMicroseconds = elapsedSeconds(start) * 1000000.0 / frames;
+        result.pairs = pairs;
+}
+
+template <class B>
+Result run(const char *structure, B &broadphase, const Scene &scene, const std::string &motion,
+           std::vector<Body> bodies, uint32_t frames, std::mt19937 &generator)
+{
+        Result result{};
+        result.scene = scene.name;
+        result.motion = motion;
+        result.structure = structure;
+        result.terrain = scene.terrain.size();
+        result.bodies = bodies.size();
+        result.frames = frames;
+        result.pairsMicroseconds = -1.0;
+        std::vector<Body> terrain = scene.terrain;
+        size_t objectCount = terrain.size() + bodies.size();
+
+        // One object at a time
+        Clock::time_point start = Clock::now();
+        for (Body &body : terrain) broadphase.insert(&body, body.bounds);
+        for (Body &body : bodies) broadphase.insert(&body, body.bounds);
+        result.insertPerSecond = objectCount / elapsedSeconds(start);
+        broadphase.clear();
+
+        // Row by row, the handles of the bodies are the ones updated from now on
+        start = Clock::now();
+        std::vector<collision::BroadphaseHandle> handles = insertRows(broadphase, terrain, bodies);
+        result.batchInsertPerSecond = objectCount / elapsedSeconds(start);
+
+        double updateSeconds = 0;
+        std::vector<double> latencies;
+        latencies.reserve(size_t(bodies.size()) * frames);
+        uint64_t candidates = 0;
+        for (uint32_t frame = 0; frame < frames; frame++) {
+                for (Body &body : bodies) moveBody(body, scene, motion, generator);
+
+                start = Clock::now();
+                for (size_t i = 0; i < bodies.size(); i++) broadphase.update(handles[i], bodies[i].bounds);
+                updateSeconds += elapsedSeconds(start);
+
+                for (Body &body : bodies) {
+                        Clock::time_point queryStart = Clock::now();
+                        broadphase.queryVisit(body.bounds, [&candidates](Body*) { candidates++; return true; });
+                        latencies.push_back(std::chrono::duration<double, std::nano>(Clock::now() - queryStart).count());
+                }
+        }
+        result.updatePerSecond = (updateSeconds > 0) ? (double(bodies.size()) * frames / updateSeconds) : 0.0;
+        result.candidates = candidates;
+
+        std::sort(latencies.begin(), latencies.end());
+        result.queryP50 = percentile(latencies, 0.50);
+        result.queryP90 = percentile(latencies, 0.90);
+        result.queryP99 = percentile(latencies, 0.99);
+        result.queryMax = latencies.empty() ? 0.0 : latencies.back();
+
+        runPairs(broadphase, frames, result);
+
+        start = Clock::now();
+        for (collision::BroadphaseHandle handle : handles) broadphase.remove(handle);
+        result.removePerSecond = bodies.empty() ? 0.0 : bodies.size() / elapsedSeconds(start);
+        return result;
+}
+
+void printResults(const std::vector<Result> &results, bool csv)
+{
+        if (csv) {
+                printf("scene,motion,structure,terrain,bodies,frames,insert_per_s,batch_insert_per_s,update_per_s,remove_per_s,"
+                       "query_p50_ns,query_p90_ns,query_p99_ns,query_max_ns,candidates,node_bytes,pairs_us_per_frame,pairs\n");
+                for (const Result &r : results) {
+                        printf("%s,%s,%s,%u,%u,%u,%.0f,%.0f,%.0f,%.0f,%.1f,%.1f,%.1f,%.1f,%llu,%u,", r.scene.c_str(), r.motion.c_str(), r.structure.c_str(),
+                               r.terrain, r.bodies, r.frames, r.insertPerSecond, r.batchInsertPerSecond, r.updatePerSecond, r.removePerSecond,
+                               r.queryP50, r.queryP90, r.queryP99, r.queryMax, (unsigned long long)r.candidates, r.nodeBytes);
+                        if (r.pairsMicroseconds >= 0) printf("%.3f,%llu\n", r.pairsMicroseconds, (unsigned long long)r.pairs);
+                        else printf(",\n");
+                }
+                return;
+        }
+
+        printf("[\n");
+        for (size_t i = 0; i < results.size(); i++) {
+                const Result &r = results[i];
+                printf("  {\"scene\": \"%s\", \"motion\": \"%s\", \"structure\": \"%s\", \"terrain\": %u, \"bodies\": %u, \"frames\": %u, "
+                       "\"insert_per_s\": %.0f, \"batch_insert_per_s\": %.0f, \"update_per_s\": %.0f, \"remove_per_s\": %.0f, "
+                       "\"query_p50_ns\": %.1f, \"query_p90_ns\": %.1f, \"query_p99_ns\": %.1f, \"query_max_ns\": %.1f, \"candidates\": %llu, "
+                       "\"node_bytes\": %u, ",
+                       r.scene.c_str(), r.motion.c_str(), r.structure.c_str(), r.terrain, r.bodies, r.frames,
+                       r.insertPerSecond, r.batchInsertPerSecond, r.updatePerSecond, r.removePerSecond, r.queryP50, r.queryP90, r.queryP99, r.queryMax,
+                       (unsigned long long)r.candidates, r.nodeBytes);
+                if (r.pairsMicroseconds >= 0) printf("\"pairs_us_per_frame\": %.3f, \"pairs\": %llu}", r.pairsMicroseconds, (unsigned long long)r.pairs);
+                else printf("\"pairs_us_per_frame\": null, \"pairs\": null}");
+                printf("%s\n", (i + 1 < results.size()) ? "," : "");
+        }
+        printf("]\n");
+}
+
+int main(int argc, char *argv[])
+{
+        bool csv = false;
+        uint32_t frames = 0;
+        uint32_t platformRows = WORLD_MAP_HEIGHT * 4;
+        std::vector<uint32_t> bodyCounts = { 100, 1000, 10000 };
+        const char *objtypesPath = "objtypes.dat";
+        for (int i = 1; i < argc; i++) {
+                if (strcmp(argv[i], "--csv") == 0) csv = true;
+                else if ((strcmp(argv[i], "--frames") == 0) && (i + 1 < argc)) frames = atoi(argv[++i]);
+                else if ((strcmp(argv[i], "--bodies") == 0) && (i + 1 < argc)) bodyCounts = { (uint32_t)atoi(argv[++i]) };
+                else if ((strcmp(argv[i], "--rows") == 0) && (i + 1 < argc)) platformRows = atoi(argv[++i]);
+                else if ((strcmp(argv[i], "--objtypes") == 0) && (i + 1 < argc)) objtypesPath = argv[++i];
+                else {
+                        fprintf(stderr, "Usage: %s [--csv] [--frames N] [--bodies N] [--rows N] [--objtypes path]\n", argv[0]);
+                        return 1;
+                }
+        }
+
+        std::map<uint16_t, collision::Bounds2> objectBounds = loadObjectBounds(objtypesPath);
+        if (objectBounds.empty()) fprintf(stderr, "%s not found, worldmap objects take a whole cell\n", objtypesPath);
+
+        std::mt19937 generator(1234);
+        std::vector<Scene> scenes;
+        scenes.push_back(worldMapScene(objectBounds));
+        scenes.push_back(platformsScene(platformRows, generator));
+        Scene cluster = scenes.front();
+        cluster.name = "cluster";
+        cluster.clustered = true;
+        cluster.clusterX = cluster.width * 0.5f;
+        cluster.clusterY = 10 * CELL_SIZE;
+        scenes.push_back(cluster);
+
+        // aabb::Node keeps three std::vector<double> (lower, upper, centre) with their own heap blocks, plus the
+        // allocator overhead not counted here
+        uint32_t aabbNodeBytes = sizeof(aabb::Node<Body*>) + 3 * 2 * sizeof(double);
+        uint32_t tree2DNodeBytes = sizeof(collision::Tree2D<Body*>::Node) + sizeof(Body*);
+
+        const char *motions[] = { "walk", "fall", "jitter", "teleport" };
+        std::vector<Result> results;
+        for (const Scene &scene : scenes) {
+                for (const char *motion : motions) {
+                        for (uint32_t bodyCount : bodyCounts) {
+                                std::vector<Body> bodies = spawnBodies(scene, motion, bodyCount, generator);
+                                uint32_t runFrames = (frames != 0) ? frames : std::max(10u, 10000u / bodyCount);
+
+                                // The same seed for every structure, so all of them see the same motion
+                                uint32_t seed = generator();
+                                std::mt19937 motionGenerator(seed);
+                                collision::AABBTreeBroadphase<Body*> tree;
+                                results.push_back(run("aabb tree", tree, scene, motion, bodies, runFrames, motionGenerator));
+                                results.back().nodeBytes = aabbNodeBytes;
+
+                                motionGenerator.seed(seed);
+                                collision::Tree2DBroadphase<Body*> tree2D;
+                                results.push_back(run("tree2d", tree2D, scene, motion, bodies, runFrames, motionGenerator));
+                                results.back().nodeBytes = tree2DNodeBytes;
+
+                                motionGenerator.seed(seed);
+                                collision::SpatialHashGrid<Body*> grid(CELL_SIZE, CELL_SIZE);
+                                results.push_back(run("grid", grid, scene, motion, bodies, runFrames, motionGenerator));
+
+                                motionGenerator.seed(seed);
+                                collision::SweepAndPrune<Body*> sweepAndPrune;
+                                results.push_back(run("sap", sweepAndPrune, scene, motion, bodies, runFrames, motionGenerator));
+                        }
+                }
+        }
+
+        printResults(results, csv);
+        return 0;
+}
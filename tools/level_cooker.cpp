@@ -0,0 +1,109 @@
+// Offline level cooker.
+//
+// Converts a level into the binary level file (.lvl) that SceneObjectManager maps in memory and streams row by row
+// as the camera climbs (see LevelMap). Without an input file it cooks the built-in level of world_map.h.
+//
+// The input is a text file with one line per row, the top row of the level first. Cells are separated by spaces or
+// commas and hold the SceneObjectIdentificator of the object placed there (0 for an empty cell), optionally followed
+// by ':' and a metadata byte (e.g. 12:3). Empty lines and lines starting with '#' are skipped.
+//
+// Usage: rocket_level_cooker <output .lvl> [input level .txt] [rows per chunk]
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdint>
+#include <level_map.h>
+#include <world_map.h>
+
+const uint16_t DEFAULT_ROWS_PER_CHUNK = 64;
+
+struct Level { uint16_t width = 0; std::vector<std::vector<uint16_t>> ids; std::vector<std::vector<uint8_t>> metadata; bool hasMetadata = false; };
+
+bool readLevel(const std::string &filename, Level &level)
+{
+        std::ifstream infile(filename);
+        if(!infile.is_open()) {
+                std::cout << "Unable to open level " << filename << std::endl;
+                return false;
+        }
+
+        std::string line;
+        uint32_t lineNumber = 0;
+        while(std::getline(infile, line)) {
+                lineNumber++;
+                if(line.empty() || (line[0] == '#')) continue;
+                std::replace(line.begin(), line.end(), ',', ' ');
+
+                std::istringstream cells(line);
+                std::string cell;
+                std::vector<uint16_t> rowIds;
+                std::vector<uint8_t> rowMetadata;
+                while(cells >> cell) {
+                        size_t separator = cell.find(':');
+                        rowIds.push_back(uint16_t(std::strtoul(cell.substr(0, separator).c_str(), nullptr, 10)));
+                        uint8_t metadata = 0;
+                        if(separator != std::string::npos) {
+                                metadata = uint8_t(std::strtoul(cell.substr(separator + 1).c_str(), nullptr, 10));
+                                level.hasMetadata = true;
+                        }
+                        rowMetadata.push_back(metadata);
+                }
+                if(rowIds.empty()) continue;
+                if(level.width == 0) level.width = rowIds.size();
+                if(rowIds.size() != level.width) {
+                        std::cout << "Line " << lineNumber << " has " << rowIds.size() << " cells instead of " << level.width << std::endl;
+                        return false;
+                }
+                level.ids.push_back(rowIds);
+                level.metadata.push_back(rowMetadata);
+        }
+        return !level.ids.empty();
+}
+
+void builtInLevel(Level &level)
+{
+        level.width = WORLD_MAP_WIDTH;
+        for(uint32_t y = 0; y < WORLD_MAP_HEIGHT; y++) {
+                level.ids.push_back(std::vector<uint16_t>(worldMap[y], worldMap[y] + WORLD_MAP_WIDTH));
+                level.metadata.push_back(std::vector<uint8_t>(WORLD_MAP_WIDTH, 0));
+        }
+}
+
+int main(int argc, char **argv)
+{
+        if(argc < 2) {
+                std::cout << "Usage: rocket_level_cooker <output .lvl> [input level .txt] [rows per chunk]" << std::endl;
+                return 1;
+        }
+
+        Level level;
+        if(argc > 2) {
+                if(!readLevel(argv[2], level)) return 1;
+        } else {
+                builtInLevel(level);
+        }
+        uint16_t rowsPerChunk = (argc > 3) ? uint16_t(std::atoi(argv[3])) : DEFAULT_ROWS_PER_CHUNK;
+
+        // Rows are read top row first and stored bottom row first, the order the camera reaches them
+        uint32_t height = level.ids.size();
+        std::vector<uint16_t> ids;
+        std::vector<uint8_t> metadata;
+        for(uint32_t row = 0; row < height; row++) {
+                uint32_t line = height - 1 - row;
+                ids.insert(ids.end(), level.ids[line].begin(), level.ids[line].end());
+                if(level.hasMetadata) metadata.insert(metadata.end(), level.metadata[line].begin(), level.metadata[line].end());
+        }
+
+        if(!LevelMap::Write(argv[1], level.width, height, rowsPerChunk, ids, metadata)) {
+                std::cout << "Failed to write level " << argv[1] << std::endl;
+                return 1;
+        }
+        std::cout << "Cooked " << level.width << "x" << height << " cells" << (level.hasMetadata ? " with metadata" : "")
+                  << " in chunks of " << rowsPerChunk << " rows into " << argv[1] << std::endl;
+        return 0;
+}